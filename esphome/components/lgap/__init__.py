@@ -1,52 +1,335 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome.cpp_helpers import gpio_pin_expression
-from esphome.components import uart
+from esphome.components import uart, sensor
 from esphome.const import (
+    CONF_BAUD_RATE,
     CONF_ID,
+    CONF_PORT,
+    CONF_MODE,
+    CONF_FAN_MODE,
+    CONF_TARGET_TEMPERATURE,
+    CONF_TRIGGER_ID,
+    UNIT_PERCENT,
+    UNIT_MILLISECOND,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    ENTITY_CATEGORY_DIAGNOSTIC,
 )
-from esphome import pins
+from esphome import automation, pins
+from esphome.core import CORE
+
+DEPENDENCIES = ["sensor", "number", "switch"]
 
-DEPENDENCIES = ["uart", "sensor", "number", "switch"]
 CODEOWNERS = ["@jourdant"]
 MULTI_CONF = True
 
+
+def AUTO_LOAD():
+    # only a bus on a tcp bridge needs the socket component, so uart builds don't pull it in
+    buses = (CORE.raw_config or {}).get("lgap") or []
+    if isinstance(buses, dict):
+        buses = [buses]
+    for bus in buses:
+        if isinstance(bus, dict) and str(bus.get(CONF_TRANSPORT, "uart")).lower() == "tcp":
+            return ["socket"]
+    return []
+
+
 #class metadata
 lgap_ns = cg.esphome_ns.namespace("lgap")
-LGAP = lgap_ns.class_("LGAP", uart.UARTDevice, cg.Component)
+LGAP = lgap_ns.class_("LGAP", cg.Component)
+LGAPTransport = lgap_ns.class_("LGAPTransport")
+LGAPUARTTransport = lgap_ns.class_("LGAPUARTTransport", LGAPTransport, uart.UARTDevice)
+LGAPTCPTransport = lgap_ns.class_("LGAPTCPTransport", LGAPTransport)
+LGAPLoopbackTransport = lgap_ns.class_("LGAPLoopbackTransport", LGAPTransport)
+TimingMode = lgap_ns.enum("TimingMode")
+BulkCommandAction = lgap_ns.class_("BulkCommandAction", automation.Action)
+DumpTraceAction = lgap_ns.class_("DumpTraceAction", automation.Action)
+SetCaptureAction = lgap_ns.class_("SetCaptureAction", automation.Action)
+BulkCompleteTrigger = lgap_ns.class_("BulkCompleteTrigger", automation.Trigger.template(cg.uint8, cg.uint8))
+
+TIMING_MODES = {
+    "fixed": TimingMode.TIMING_MODE_FIXED,
+    "wire": TimingMode.TIMING_MODE_WIRE,
+}
 
 #setting names
 CONF_LGAP_ID = "lgap_id"
+CONF_TRANSPORT = "transport"
+CONF_TRANSPORT_ID = "transport_id"
+CONF_HOST = "host"
+CONF_RECONNECT_INTERVAL = "reconnect_interval"
+CONF_BUS_TASK = "bus_task"
 CONF_RECEIVE_WAIT_TIME = "receive_wait_time"
 CONF_LOOP_WAIT_TIME = "loop_wait_time"
 CONF_FLOW_CONTROL_PIN = "flow_control_pin"
+CONF_NATIVE_RS485 = "native_rs485"
 CONF_TX_BYTE_0 = "tx_byte_0"
+CONF_MIN_READ_SHARE = "min_read_share"
+CONF_TIMING_MODE = "timing_mode"
+CONF_MIN_TURNAROUND = "min_turnaround"
+CONF_STATS_INTERVAL = "stats_interval"
+CONF_MAX_IN_FLIGHT = "max_in_flight"
+CONF_PUBLISH_COALESCE_WINDOW = "publish_coalesce_window"
+CONF_BUS_UTILISATION = "bus_utilisation"
+CONF_TRANSACTION_RATE = "transaction_rate"
+CONF_TRANSACTIONS = "transactions"
+CONF_TIMEOUTS = "timeouts"
+CONF_CHECKSUM_FAILURES = "checksum_failures"
+CONF_RESYNCS = "resyncs"
+CONF_OUT_OF_ORDER = "out_of_order"
+CONF_LATENCY_P50 = "latency_p50"
+CONF_LATENCY_P95 = "latency_p95"
+CONF_LATENCY_MAX = "latency_max"
+CONF_BACKOFF_INITIAL = "backoff_initial"
+CONF_BACKOFF_MAX = "backoff_max"
+CONF_UNAVAILABLE_AFTER = "unavailable_after"
+CONF_DISCOVERY = "discovery"
+CONF_FORCE_SCAN = "force_scan"
+CONF_PROBE_TIMEOUT = "probe_timeout"
+CONF_REPROBE_INTERVAL = "reprobe_interval"
+CONF_PROBE_HEADERS = "probe_headers"
+CONF_DISCOVERED_ZONES = "discovered_zones"
+CONF_ODU = "odu"
+CONF_TOTAL_LOAD = "total_load"
+CONF_LOAD_PERCENT = "load_percent"
+CONF_DESIGN_LOAD_TOTAL = "design_load_total"
+CONF_ACTIVE_ZONES = "active_zones"
+CONF_LOAD_DEADBAND = "load_deadband"
+CONF_GROUP = "group"
+CONF_ZONES = "zones"
+CONF_ON_BULK_COMPLETE = "on_bulk_complete"
+CONF_TRACE_SIZE = "trace_size"
+CONF_WARM_START = "warm_start"
+CONF_STATE_SAVE_DELAY = "state_save_delay"
+CONF_BOOT_SWEEP = "boot_sweep"
+CONF_TIME_TO_FULL_STATE = "time_to_full_state"
+CONF_FORMAT = "format"
+
+TRACE_FORMATS = ["text", "capture"]
+
+# names understood by parse_bulk_mode() and parse_bulk_fan_mode()
+BULK_MODES = ["OFF", "COOL", "HEAT", "DRY", "FAN_ONLY", "HEAT_COOL"]
+BULK_FAN_MODES = ["LOW", "MEDIUM", "HIGH", "AUTO", "QUIET", "FOCUS"]
+
+# bus health counters since boot
+COUNTER_SENSORS = {
+    CONF_TRANSACTIONS: "set_transactions_sensor",
+    CONF_TIMEOUTS: "set_timeouts_sensor",
+    CONF_CHECKSUM_FAILURES: "set_checksum_failures_sensor",
+    CONF_RESYNCS: "set_resyncs_sensor",
+    CONF_OUT_OF_ORDER: "set_out_of_order_sensor",
+}
+
+# response latency over each stats interval
+LATENCY_SENSORS = {
+    CONF_LATENCY_P50: "set_latency_p50_sensor",
+    CONF_LATENCY_P95: "set_latency_p95_sensor",
+    CONF_LATENCY_MAX: "set_latency_max_sensor",
+}
+
+DISCOVERY_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_FORCE_SCAN, default=False): cv.boolean,
+        # unset, probes wait as long as polls do
+        cv.Optional(CONF_PROBE_TIMEOUT): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_REPROBE_INTERVAL, default="30s"): cv.positive_time_period_milliseconds,
+        # tried after tx_byte_0 when nothing answers it
+        cv.Optional(CONF_PROBE_HEADERS, default=[0x80, 0x00]): cv.ensure_list(cv.hex_uint8_t),
+        cv.Optional(CONF_DISCOVERED_ZONES): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+# RX14 and the totals built from every zone's RX13 and RX12, published once per bus
+ODU_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_LOAD_DEADBAND, default=0): cv.positive_float,
+        cv.Optional(CONF_TOTAL_LOAD): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_LOAD_PERCENT): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_DESIGN_LOAD_TOTAL): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_ACTIVE_ZONES): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+    }
+)
+
+ODU_SENSORS = {
+    CONF_TOTAL_LOAD: "set_odu_total_load_sensor",
+    CONF_LOAD_PERCENT: "set_odu_load_percent_sensor",
+    CONF_DESIGN_LOAD_TOTAL: "set_odu_design_load_total_sensor",
+    CONF_ACTIVE_ZONES: "set_odu_active_zones_sensor",
+}
 
 #build schema
-CONFIG_SCHEMA = uart.UART_DEVICE_SCHEMA.extend(
+BASE_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(LGAP),
-        cv.Optional(CONF_FLOW_CONTROL_PIN): pins.gpio_output_pin_schema,
+        # run the wire side of the bus in its own task, ESP32 and host only
+        cv.Optional(CONF_BUS_TASK, default=False): cv.boolean,
         cv.Optional(CONF_RECEIVE_WAIT_TIME, default="500ms"): cv.positive_time_period_milliseconds,
         cv.Optional(CONF_LOOP_WAIT_TIME, default="500ms"): cv.positive_time_period_milliseconds,
         cv.Optional(CONF_TX_BYTE_0, default=0x80): cv.hex_uint8_t,
+        cv.Optional(CONF_MIN_READ_SHARE, default="25%"): cv.percentage,
+        cv.Optional(CONF_TIMING_MODE, default="fixed"): cv.enum(TIMING_MODES, lower=True),
+        cv.Optional(CONF_MIN_TURNAROUND, default="20ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_STATS_INTERVAL, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_IN_FLIGHT, default=1): cv.int_range(min=1, max=4),
+        cv.Optional(CONF_PUBLISH_COALESCE_WINDOW, default="5s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_BACKOFF_INITIAL, default="1s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_BACKOFF_MAX, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_UNAVAILABLE_AFTER, default=3): cv.int_range(min=1, max=255),
+        # poll every zone back to back at boot until each has answered or is unavailable
+        cv.Optional(CONF_BOOT_SWEEP, default=True): cv.boolean,
+        cv.Optional(CONF_TIME_TO_FULL_STATE): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        # last frames kept in ram for lgap.dump_trace, 0 disables the trace
+        cv.Optional(CONF_TRACE_SIZE, default=32): cv.int_range(min=0, max=1024),
+        # publish every zone's last known state at boot, saved to flash at most once per state_save_delay
+        cv.Optional(CONF_WARM_START, default=True): cv.boolean,
+        cv.Optional(CONF_STATE_SAVE_DELAY, default="60s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_BUS_UTILISATION): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_TRANSACTION_RATE): sensor.sensor_schema(
+            unit_of_measurement="tx/s",
+            accuracy_decimals=2,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        cv.Optional(CONF_DISCOVERY): DISCOVERY_SCHEMA,
+        cv.Optional(CONF_ODU): ODU_SCHEMA,
+        cv.Optional(CONF_ON_BULK_COMPLETE): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(BulkCompleteTrigger),
+            }
+        ),
+    }
+).extend(
+    {
+        cv.Optional(key): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        )
+        for key in COUNTER_SENSORS
+    }
+).extend(
+    {
+        cv.Optional(key): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        )
+        for key in LATENCY_SENSORS
     }
 ).extend(cv.COMPONENT_SCHEMA)
 
 
+def validate_native_rs485(config):
+    if not config.get(CONF_NATIVE_RS485, False):
+        return config
+    if CONF_FLOW_CONTROL_PIN not in config:
+        raise cv.Invalid("native_rs485 drives flow_control_pin from the uart, set flow_control_pin too")
+    if not CORE.using_esp_idf:
+        raise cv.Invalid("native_rs485 is only available on the ESP32 with the esp-idf framework")
+    return config
+
+
+def validate_bus_task(config):
+    if not config[CONF_BUS_TASK]:
+        return config
+    if not (CORE.is_esp32 or CORE.is_host):
+        raise cv.Invalid("bus_task is only available on the ESP32 and the host platform")
+    if config[CONF_TRANSPORT] == "loopback":
+        raise cv.Invalid("the loopback transport is fed from the main loop, it can't run in the bus task")
+    return config
+
+
+# what the bus runs over, uart unless transport says otherwise so existing configs keep working
+CONFIG_SCHEMA = cv.All(
+    cv.typed_schema(
+        {
+            "uart": BASE_SCHEMA.extend(uart.UART_DEVICE_SCHEMA).extend(
+                {
+                    cv.GenerateID(CONF_TRANSPORT_ID): cv.declare_id(LGAPUARTTransport),
+                    cv.Optional(CONF_FLOW_CONTROL_PIN): pins.gpio_output_pin_schema,
+                    # let the ESP32 uart drive flow_control_pin in rs485 half duplex mode
+                    cv.Optional(CONF_NATIVE_RS485, default=False): cv.boolean,
+                }
+            ),
+            # an RS485 bridge in transparent mode, raw bytes over a tcp socket
+            "tcp": BASE_SCHEMA.extend(
+                {
+                    cv.GenerateID(CONF_TRANSPORT_ID): cv.declare_id(LGAPTCPTransport),
+                    cv.Required(CONF_HOST): cv.ipv4address,
+                    cv.Required(CONF_PORT): cv.port,
+                    # the bridge's serial side, only used for timing
+                    cv.Optional(CONF_BAUD_RATE, default=4800): cv.int_range(min=300, max=115200),
+                    cv.Optional(CONF_RECONNECT_INTERVAL, default="5s"): cv.positive_time_period_milliseconds,
+                }
+            ),
+            # in-memory, for bench tests driven from lambdas through transport_id
+            "loopback": BASE_SCHEMA.extend(
+                {
+                    cv.GenerateID(CONF_TRANSPORT_ID): cv.declare_id(LGAPLoopbackTransport),
+                }
+            ),
+        },
+        key=CONF_TRANSPORT,
+        default_type="uart",
+        lower=True,
+    ),
+    validate_native_rs485,
+    validate_bus_task,
+)
+
+
 async def to_code(config):
     #register device
     cg.add_global(lgap_ns.using)
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
 
-    #connect this object to the parent uart device
-    await uart.register_uart_device(var, config)
+    #transport
+    transport = cg.new_Pvariable(config[CONF_TRANSPORT_ID])
+    cg.add(var.set_transport(transport))
+    if config[CONF_TRANSPORT] == "uart":
+        cg.add_define("USE_LGAP_UART")
+        await uart.register_uart_device(transport, config)
+        if CONF_FLOW_CONTROL_PIN in config:
+            pin = await gpio_pin_expression(config[CONF_FLOW_CONTROL_PIN])
+            cg.add(var.set_flow_control_pin(pin))
+        cg.add(var.set_native_rs485(config[CONF_NATIVE_RS485]))
+    elif config[CONF_TRANSPORT] == "tcp":
+        cg.add_define("USE_LGAP_TCP")
+        cg.add(transport.set_host(str(config[CONF_HOST])))
+        cg.add(transport.set_port(config[CONF_PORT]))
+        cg.add(transport.set_baud_rate(config[CONF_BAUD_RATE]))
+        cg.add(transport.set_reconnect_interval(config[CONF_RECONNECT_INTERVAL]))
 
-    #map properties from yaml to the c++ object
-    if CONF_FLOW_CONTROL_PIN in config:
-        pin = await gpio_pin_expression(config[CONF_FLOW_CONTROL_PIN])
-        cg.add(var.set_flow_control_pin(pin))
+    cg.add(var.set_bus_task(config[CONF_BUS_TASK]))
 
     #times
     cg.add(var.set_receive_wait_time(config[CONF_RECEIVE_WAIT_TIME]))
@@ -54,3 +337,147 @@ async def to_code(config):
     
     #first tx byte
     cg.add(var.set_tx_byte_0(config[CONF_TX_BYTE_0]))
+
+    #scheduling
+    cg.add(var.set_min_read_share(config[CONF_MIN_READ_SHARE]))
+    cg.add(var.set_timing_mode(config[CONF_TIMING_MODE]))
+    cg.add(var.set_min_turnaround(config[CONF_MIN_TURNAROUND]))
+    cg.add(var.set_stats_interval(config[CONF_STATS_INTERVAL]))
+    cg.add(var.set_max_in_flight(config[CONF_MAX_IN_FLIGHT]))
+    cg.add(var.set_publish_coalesce_window(config[CONF_PUBLISH_COALESCE_WINDOW]))
+
+    #dead zone backoff
+    cg.add(var.set_backoff_initial(config[CONF_BACKOFF_INITIAL]))
+    cg.add(var.set_backoff_max(config[CONF_BACKOFF_MAX]))
+    cg.add(var.set_unavailable_after(config[CONF_UNAVAILABLE_AFTER]))
+
+    #boot sweep
+    cg.add(var.set_boot_sweep(config[CONF_BOOT_SWEEP]))
+    if CONF_TIME_TO_FULL_STATE in config:
+        sens = await sensor.new_sensor(config[CONF_TIME_TO_FULL_STATE])
+        cg.add(var.set_time_to_full_state_sensor(sens))
+    cg.add(var.set_trace_size(config[CONF_TRACE_SIZE]))
+
+    #warm start
+    cg.add(var.set_warm_start(config[CONF_WARM_START]))
+    cg.add(var.set_state_key(str(config[CONF_ID])))
+    cg.add(var.set_state_save_delay(config[CONF_STATE_SAVE_DELAY]))
+
+    #bus statistics
+    if CONF_BUS_UTILISATION in config:
+        sens = await sensor.new_sensor(config[CONF_BUS_UTILISATION])
+        cg.add(var.set_bus_utilisation_sensor(sens))
+    if CONF_TRANSACTION_RATE in config:
+        sens = await sensor.new_sensor(config[CONF_TRANSACTION_RATE])
+        cg.add(var.set_transaction_rate_sensor(sens))
+
+    #bus health
+    for key, setter in {**COUNTER_SENSORS, **LATENCY_SENSORS}.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(var, setter)(sens))
+
+    #zone discovery
+    if CONF_DISCOVERY in config:
+        discovery = config[CONF_DISCOVERY]
+        cg.add(var.set_discovery_enabled(True))
+        cg.add(var.set_discovery_key(str(config[CONF_ID])))
+        cg.add(var.set_force_scan(discovery[CONF_FORCE_SCAN]))
+        if CONF_PROBE_TIMEOUT in discovery:
+            cg.add(var.set_probe_timeout(discovery[CONF_PROBE_TIMEOUT]))
+        cg.add(var.set_reprobe_interval(discovery[CONF_REPROBE_INTERVAL]))
+        headers = [config[CONF_TX_BYTE_0]]
+        headers += [h for h in discovery[CONF_PROBE_HEADERS] if h not in headers]
+        for header in headers:
+            cg.add(var.add_probe_header(header))
+        if CONF_DISCOVERED_ZONES in discovery:
+            sens = await sensor.new_sensor(discovery[CONF_DISCOVERED_ZONES])
+            cg.add(var.set_discovered_zones_sensor(sens))
+
+    #odu aggregate
+    if CONF_ODU in config:
+        odu = config[CONF_ODU]
+        cg.add(var.set_odu_load_deadband(odu[CONF_LOAD_DEADBAND]))
+        for key, setter in ODU_SENSORS.items():
+            if key in odu:
+                sens = await sensor.new_sensor(odu[key])
+                cg.add(getattr(var, setter)(sens))
+
+    #bulk commands
+    for conf in config.get(CONF_ON_BULK_COMPLETE, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [(cg.uint8, "confirmed"), (cg.uint8, "failed")], conf)
+
+
+# one target state for several zones, written back to back ahead of polling.
+# zones wins over group, with neither every zone is commanded
+BULK_COMMAND_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.use_id(LGAP),
+            cv.Exclusive(CONF_GROUP, "zones"): cv.templatable(cv.int_range(min=0, max=15)),
+            cv.Exclusive(CONF_ZONES, "zones"): cv.ensure_list(cv.int_range(min=0, max=255)),
+            cv.Optional(CONF_MODE): cv.templatable(cv.one_of(*BULK_MODES, upper=True)),
+            cv.Optional(CONF_FAN_MODE): cv.templatable(cv.one_of(*BULK_FAN_MODES, upper=True)),
+            cv.Optional(CONF_TARGET_TEMPERATURE): cv.templatable(cv.float_range(min=16, max=30)),
+        }
+    ),
+    cv.has_at_least_one_key(CONF_MODE, CONF_FAN_MODE, CONF_TARGET_TEMPERATURE),
+)
+
+
+@automation.register_action("lgap.bulk_command", BulkCommandAction, BULK_COMMAND_SCHEMA)
+async def bulk_command_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    if CONF_GROUP in config:
+        templ = await cg.templatable(config[CONF_GROUP], args, cg.int_)
+        cg.add(var.set_group(templ))
+    if CONF_ZONES in config:
+        cg.add(var.set_zones(config[CONF_ZONES]))
+    if CONF_MODE in config:
+        templ = await cg.templatable(config[CONF_MODE], args, cg.std_string)
+        cg.add(var.set_mode(templ))
+    if CONF_FAN_MODE in config:
+        templ = await cg.templatable(config[CONF_FAN_MODE], args, cg.std_string)
+        cg.add(var.set_fan_mode(templ))
+    if CONF_TARGET_TEMPERATURE in config:
+        templ = await cg.templatable(config[CONF_TARGET_TEMPERATURE], args, cg.float_)
+        cg.add(var.set_target_temperature(templ))
+    return var
+
+
+# capture lines are what tools/lgap_capture.py extracts from the logs
+@automation.register_action(
+    "lgap.dump_trace",
+    DumpTraceAction,
+    cv.maybe_simple_value(
+        {
+            cv.GenerateID(): cv.use_id(LGAP),
+            cv.Optional(CONF_FORMAT, default="text"): cv.one_of(*TRACE_FORMATS, lower=True),
+        },
+        key=CONF_ID,
+    ),
+)
+async def dump_trace_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    cg.add(var.set_capture(config[CONF_FORMAT] == "capture"))
+    return var
+
+
+CAPTURE_ACTION_SCHEMA = cv.maybe_simple_value({cv.GenerateID(): cv.use_id(LGAP)}, key=CONF_ID)
+
+
+@automation.register_action("lgap.start_capture", SetCaptureAction, CAPTURE_ACTION_SCHEMA)
+async def start_capture_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg, True)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
+
+
+@automation.register_action("lgap.stop_capture", SetCaptureAction, CAPTURE_ACTION_SCHEMA)
+async def stop_capture_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg, False)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
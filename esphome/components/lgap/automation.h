@@ -0,0 +1,89 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "esphome/core/automation.h"
+#include "esphome/core/log.h"
+#include "lgap.h"
+#include "lgap_bulk.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // lgap.bulk_command, fields left out are not changed
+    template<typename... Ts> class BulkCommandAction : public Action<Ts...>, public Parented<LGAP>
+    {
+      public:
+        TEMPLATABLE_VALUE(std::string, mode)
+        TEMPLATABLE_VALUE(std::string, fan_mode)
+        TEMPLATABLE_VALUE(float, target_temperature)
+        TEMPLATABLE_VALUE(int, group)
+
+        void set_zones(const std::vector<int> &zones) { this->zones_ = zones; }
+
+        void play(Ts... x) override
+        {
+          LGAPBulkTarget target;
+          if (this->mode_.has_value() && !parse_bulk_mode(this->mode_.value(x...), target))
+          {
+            ESP_LOGW("lgap", "Unknown bulk command mode %s", this->mode_.value(x...).c_str());
+            return;
+          }
+          if (this->fan_mode_.has_value() && !parse_bulk_fan_mode(this->fan_mode_.value(x...), target))
+          {
+            ESP_LOGW("lgap", "Unknown bulk command fan mode %s", this->fan_mode_.value(x...).c_str());
+            return;
+          }
+          if (this->target_temperature_.has_value())
+            target.target_temperature = this->target_temperature_.value(x...);
+
+          int group = this->group_.has_value() ? this->group_.value(x...) : -1;
+          this->parent_->bulk_command(target, group, this->zones_);
+        }
+
+      protected:
+        std::vector<int> zones_{};
+    };
+
+    // lgap.dump_trace, logs the frame trace oldest first, as text or as capture lines
+    template<typename... Ts> class DumpTraceAction : public Action<Ts...>, public Parented<LGAP>
+    {
+      public:
+        void set_capture(bool capture) { this->capture_ = capture; }
+
+        void play(Ts... x) override
+        {
+          if (this->capture_)
+            this->parent_->dump_trace_capture();
+          else
+            this->parent_->dump_trace();
+        }
+
+      protected:
+        bool capture_{false};
+    };
+
+    // lgap.start_capture and lgap.stop_capture
+    template<typename... Ts> class SetCaptureAction : public Action<Ts...>, public Parented<LGAP>
+    {
+      public:
+        explicit SetCaptureAction(bool streaming) : streaming_(streaming) {}
+
+        void play(Ts... x) override { this->parent_->set_capture_streaming(this->streaming_); }
+
+      protected:
+        bool streaming_;
+    };
+
+    // fires once every zone of a bulk command has confirmed its write or given up
+    class BulkCompleteTrigger : public Trigger<uint8_t, uint8_t>
+    {
+      public:
+        explicit BulkCompleteTrigger(LGAP *parent)
+        {
+          parent->add_on_bulk_complete_callback([this](uint8_t confirmed, uint8_t failed) { this->trigger(confirmed, failed); });
+        }
+    };
+
+  } // namespace lgap
+} // namespace esphome
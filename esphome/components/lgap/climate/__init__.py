@@ -1,14 +1,21 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import climate, sensor, number, switch
+from esphome import automation
+from esphome.components import climate, sensor, binary_sensor, number, switch
 from esphome.const import (
     CONF_ID,
     CONF_NAME,
+    CONF_TRIGGER_ID,
     UNIT_CELSIUS,
     UNIT_MINUTE,
+    UNIT_SECOND,
+    UNIT_MILLISECOND,
     DEVICE_CLASS_TEMPERATURE,
     DEVICE_CLASS_DURATION,
+    DEVICE_CLASS_CONNECTIVITY,
     STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    ENTITY_CATEGORY_DIAGNOSTIC,
 )
 from .. import (
     lgap_ns,
@@ -17,6 +24,7 @@ from .. import (
 )
 
 DEPENDENCIES = ["lgap"]
+AUTO_LOAD = ["binary_sensor"]
 CODEOWNERS = ["@jourdant"]
 
 LGAP_HVAC_Climate = lgap_ns.class_("LGAPHVACClimate", cg.Component, climate.Climate)
@@ -27,9 +35,25 @@ LockFanSpeedSwitch = lgap_ns.class_("LockFanSpeedSwitch", switch.Switch)
 LockModeSwitch = lgap_ns.class_("LockModeSwitch", switch.Switch)
 PowerOnlyModeSwitch = lgap_ns.class_("PowerOnlyModeSwitch", switch.Switch)
 PlasmaSwitch = lgap_ns.class_("PlasmaSwitch", switch.Switch)
+WriteFailedTrigger = lgap_ns.class_("WriteFailedTrigger", automation.Trigger.template())
+LGAPFieldFormula = lgap_ns.enum("LGAPFieldFormula")
+
+FIELD_FORMULAS = {
+    "linear": LGAPFieldFormula.FIELD_LINEAR,
+    "lg_temperature": LGAPFieldFormula.FIELD_LG_TEMPERATURE,
+    "signed": LGAPFieldFormula.FIELD_SIGNED,
+}
 
 CONF_ZONE_NUMBER = "zone"
 CONF_TEMPERATURE_PUBISH_TIME = "temperature_publish_time"
+CONF_MAX_STALENESS_OFF = "max_staleness_off"
+CONF_MAX_STALENESS_RUNNING = "max_staleness_running"
+CONF_FAST_POLL_INTERVAL = "fast_poll_interval"
+CONF_FAST_POLL_DURATION = "fast_poll_duration"
+CONF_HEARTBEAT_INTERVAL = "heartbeat_interval"
+CONF_WRITE_DEBOUNCE = "write_debounce"
+CONF_PIPE_TEMPERATURE_DEADBAND = "pipe_temperature_deadband"
+CONF_LOAD_DEADBAND = "load_deadband"
 CONF_SUPPORTS_AUTO_SWING = "supports_auto_swing"
 CONF_SUPPORTS_AUTO_FAN = "supports_auto_fan"
 CONF_SUPPORTS_QUIET_FAN = "supports_quiet_fan"
@@ -50,6 +74,49 @@ CONF_LOCK_TEMPERATURE = "lock_temperature"
 CONF_LOCK_FAN_SPEED = "lock_fan_speed"
 CONF_LOCK_MODE = "lock_mode"
 CONF_POWER_ONLY_MODE = "power_only_mode"
+CONF_POLL_INTERVAL = "poll_interval"
+CONF_TIMEOUTS = "timeouts"
+CONF_AVAILABLE = "available"
+CONF_WRITE_RETRIES = "write_retries"
+CONF_WRITE_ACK_LATENCY = "write_ack_latency"
+CONF_ON_WRITE_FAILED = "on_write_failed"
+CONF_EXTRA_FIELDS = "extra_fields"
+CONF_BYTE = "byte"
+CONF_MASK = "mask"
+CONF_SHIFT = "shift"
+CONF_SCALE = "scale"
+CONF_OFFSET = "offset"
+CONF_FORMULA = "formula"
+CONF_DEADBAND = "deadband"
+
+
+def validate_field_mask(config):
+    if (config[CONF_MASK] >> config[CONF_SHIFT]) == 0:
+        raise cv.Invalid(f"mask 0x{config[CONF_MASK]:02X} has no bits left after a shift of {config[CONF_SHIFT]}")
+    return config
+
+
+# RX0, RX2, RX4 and RX15 are framing, not data
+FIELD_BYTES = [1, 3, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14]
+
+# any response byte as a sensor: (RX[byte] & mask) >> shift, then the formula. see lgap_fields.h
+EXTRA_FIELD_SCHEMA = cv.All(
+    sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_MEASUREMENT,
+    ).extend(
+        {
+            cv.Required(CONF_BYTE): cv.one_of(*FIELD_BYTES, int=True),
+            cv.Optional(CONF_MASK, default=0xFF): cv.hex_uint8_t,
+            cv.Optional(CONF_SHIFT, default=0): cv.int_range(min=0, max=7),
+            cv.Optional(CONF_SCALE, default=1.0): cv.float_,
+            cv.Optional(CONF_OFFSET, default=0.0): cv.float_,
+            cv.Optional(CONF_FORMULA, default="linear"): cv.enum(FIELD_FORMULAS, lower=True),
+            cv.Optional(CONF_DEADBAND, default=0): cv.positive_float,
+        }
+    ),
+    validate_field_mask,
+)
 
 CONFIG_SCHEMA = climate.climate_schema(
     LGAP_HVAC_Climate
@@ -58,6 +125,15 @@ CONFIG_SCHEMA = climate.climate_schema(
         cv.GenerateID(CONF_LGAP_ID): cv.use_id(LGAP),
         cv.Optional(CONF_ZONE_NUMBER, default=0): cv.All(cv.int_),
         cv.Optional(CONF_TEMPERATURE_PUBISH_TIME, default="300000ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_STALENESS_OFF, default="0ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_MAX_STALENESS_RUNNING, default="0ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_FAST_POLL_INTERVAL, default="1s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_FAST_POLL_DURATION, default="10s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_HEARTBEAT_INTERVAL, default="10min"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_WRITE_DEBOUNCE, default="200ms"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_WRITE_RETRIES, default=2): cv.int_range(min=0, max=10),
+        cv.Optional(CONF_PIPE_TEMPERATURE_DEADBAND, default=0.5): cv.positive_float,
+        cv.Optional(CONF_LOAD_DEADBAND, default=0): cv.positive_float,
         cv.Optional(CONF_SUPPORTS_AUTO_SWING, default=False): cv.boolean,
         cv.Optional(CONF_SUPPORTS_AUTO_FAN, default=False): cv.boolean,
         cv.Optional(CONF_SUPPORTS_QUIET_FAN, default=False): cv.boolean,
@@ -91,9 +167,36 @@ CONFIG_SCHEMA = climate.climate_schema(
             accuracy_decimals=0,
             state_class=STATE_CLASS_MEASUREMENT,
         ),
-        cv.Optional(CONF_ODU_TOTAL_LOAD_SENSOR): sensor.sensor_schema(
+        # RX14 is the same for every zone, it's published once per bus by the lgap component
+        cv.Optional(CONF_ODU_TOTAL_LOAD_SENSOR): cv.invalid(
+            "odu_total_load_sensor has moved to the lgap component, use odu: total_load there"
+        ),
+        cv.Optional(CONF_POLL_INTERVAL): sensor.sensor_schema(
+            unit_of_measurement=UNIT_SECOND,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_TIMEOUTS): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_AVAILABLE): binary_sensor.binary_sensor_schema(
+            device_class=DEVICE_CLASS_CONNECTIVITY,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_WRITE_ACK_LATENCY): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
             accuracy_decimals=0,
             state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_EXTRA_FIELDS, default=[]): cv.ensure_list(EXTRA_FIELD_SCHEMA),
+        cv.Optional(CONF_ON_WRITE_FAILED): automation.validate_automation(
+            {
+                cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(WriteFailedTrigger),
+            }
         ),
         cv.Optional(CONF_SLEEP_TIMER): number.number_schema(
             TimerDurationNumber,
@@ -143,6 +246,15 @@ async def to_code(config):
     #set properties of the climate component
     cg.add(var.set_zone_number(config[CONF_ZONE_NUMBER]))
     cg.add(var.set_temperature_publish_time(config[CONF_TEMPERATURE_PUBISH_TIME]))
+    cg.add(var.set_max_staleness_off(config[CONF_MAX_STALENESS_OFF]))
+    cg.add(var.set_max_staleness_running(config[CONF_MAX_STALENESS_RUNNING]))
+    cg.add(var.set_fast_poll_interval(config[CONF_FAST_POLL_INTERVAL]))
+    cg.add(var.set_fast_poll_duration(config[CONF_FAST_POLL_DURATION]))
+    cg.add(var.set_heartbeat_interval(config[CONF_HEARTBEAT_INTERVAL]))
+    cg.add(var.set_write_debounce(config[CONF_WRITE_DEBOUNCE]))
+    cg.add(var.set_write_retries(config[CONF_WRITE_RETRIES]))
+    cg.add(var.set_pipe_temperature_deadband(config[CONF_PIPE_TEMPERATURE_DEADBAND]))
+    cg.add(var.set_load_deadband(config[CONF_LOAD_DEADBAND]))
     cg.add(var.set_supports_auto_swing(config[CONF_SUPPORTS_AUTO_SWING]))
     cg.add(var.set_supports_auto_fan(config[CONF_SUPPORTS_AUTO_FAN]))
     cg.add(var.set_supports_quiet_fan(config[CONF_SUPPORTS_QUIET_FAN]))
@@ -247,7 +359,6 @@ async def to_code(config):
         (CONF_ZONE_ACTIVE_LOAD_SENSOR, "set_zone_active_load_sensor", "zone_active_load", "Zone Active Load"),
         (CONF_ZONE_POWER_STATE_SENSOR, "set_zone_power_state_sensor", "zone_power_state", "Zone Power State"),
         (CONF_ZONE_DESIGN_LOAD_SENSOR, "set_zone_design_load_sensor", "zone_design_load", "Zone Design Load"),
-        (CONF_ODU_TOTAL_LOAD_SENSOR, "set_odu_total_load_sensor", "odu_total_load", "ODU Total Load"),
     ]
     
     for conf_key, setter_method, id_suffix, name_suffix in lonworks_load_sensors:
@@ -280,6 +391,55 @@ async def to_code(config):
             sens = await sensor.new_sensor(sensor_config)
             cg.add(getattr(var, setter_method)(sens))
     
+    # Bus health diagnostics - only when configured
+    if CONF_POLL_INTERVAL in config:
+        sens = await sensor.new_sensor(config[CONF_POLL_INTERVAL])
+        cg.add(var.set_poll_interval_sensor(sens))
+    if CONF_TIMEOUTS in config:
+        sens = await sensor.new_sensor(config[CONF_TIMEOUTS])
+        cg.add(var.set_timeouts_sensor(sens))
+
+    # Write acknowledgement
+    if CONF_WRITE_ACK_LATENCY in config:
+        sens = await sensor.new_sensor(config[CONF_WRITE_ACK_LATENCY])
+        cg.add(var.set_write_ack_latency_sensor(sens))
+    for conf in config.get(CONF_ON_WRITE_FAILED, []):
+        trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+        await automation.build_automation(trigger, [], conf)
+
+    #extra fields, no per-field code needed
+    for field in config[CONF_EXTRA_FIELDS]:
+        sens = await sensor.new_sensor(field)
+        cg.add(var.add_field_sensor(field[CONF_BYTE], field[CONF_MASK], field[CONF_SHIFT], field[CONF_SCALE], field[CONF_OFFSET],
+                                    field[CONF_FORMULA], sens, field[CONF_DEADBAND]))
+
+    # Availability - auto-generate if not explicitly configured
+    # Goes off once the zone stops answering or reports its IDU disconnected
+    if CONF_AVAILABLE in config:
+        bs = await binary_sensor.new_binary_sensor(config[CONF_AVAILABLE])
+        cg.add(var.set_available_sensor(bs))
+    else:
+        from esphome.core import ID
+        climate_id = config[CONF_ID].id
+        bs_id = ID(f"{climate_id}_available", is_manual=False, type=binary_sensor.BinarySensor)
+
+        if CONF_NAME in config:
+            bs_name = f"{config[CONF_NAME]} Available"
+        else:
+            friendly_name = climate_id.replace("_", " ").title()
+            bs_name = f"{friendly_name} Available"
+
+        bs_config = binary_sensor.binary_sensor_schema(
+            device_class=DEVICE_CLASS_CONNECTIVITY,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        )({
+            CONF_ID: bs_id,
+            CONF_NAME: bs_name,
+        })
+
+        bs = await binary_sensor.new_binary_sensor(bs_config)
+        cg.add(var.set_available_sensor(bs))
+
     # Sleep timer - auto-generate if not explicitly configured
     # Automatic timer: set minutes to start, set to 0 to cancel
     if CONF_SLEEP_TIMER in config:
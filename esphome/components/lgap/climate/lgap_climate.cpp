@@ -1,5 +1,7 @@
 #include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
+#include <cinttypes>
+#include <cmath>
 
 #include "../lgap.h"
 #include "lgap_climate.h"
@@ -64,7 +66,7 @@
 //   Constant per IDU design capacity (e.g., 9, 12, 24)
 //
 // ODU Total Load (message[14]):
-//   ~Sum of design loads of ON zones, smoothed (0-255)
+//   ~Sum of design loads of ON zones, smoothed (0-255), tracked by LGAPOdu
 
 namespace esphome
 {
@@ -157,29 +159,66 @@ namespace esphome
     static const uint8_t MIN_TEMPERATURE_NON_HEAT = 18;  // 18°C minimum for cool/dry/fan/auto modes
     static const uint8_t MAX_TEMPERATURE = 30;  // Maximum is 30°C for all modes
 
-    // Approximate LG pipe temperature mapping in °C.
-    // This is consistent with the room-sensor mapping and gives realistic values.
-    // Same formula as room temp: Temp(°C) = (192 - raw) / 3
-    inline float lgap_raw_to_pipe_temp(uint8_t raw) {
-      return float(192 - raw) / 3.0f;
+    // TX5/RX6 bits 0-2, indexed by the mode code. 3 is heat/cool, which is essentially auto
+    static constexpr climate::ClimateMode LGAP_MODES[] = {climate::CLIMATE_MODE_COOL, climate::CLIMATE_MODE_DRY, climate::CLIMATE_MODE_FAN_ONLY,
+                                                         climate::CLIMATE_MODE_HEAT_COOL, climate::CLIMATE_MODE_HEAT};
+    static constexpr uint8_t LGAP_MODE_COUNT = sizeof(LGAP_MODES) / sizeof(LGAP_MODES[0]);
+
+    // TX5/RX6 bits 4-6, fan code n is at index n - 1. 0 is NO_CHANGE and never sent or decoded.
+    // 5 is SLOW, 6 is POWER/TURBO and 7 is SLOW+POWER, which is rare and shown as FOCUS too
+    static constexpr climate::ClimateFanMode LGAP_FAN_MODES[] = {climate::CLIMATE_FAN_LOW,  climate::CLIMATE_FAN_MEDIUM, climate::CLIMATE_FAN_HIGH,
+                                                                climate::CLIMATE_FAN_AUTO, climate::CLIMATE_FAN_QUIET,  climate::CLIMATE_FAN_FOCUS,
+                                                                climate::CLIMATE_FAN_FOCUS};
+
+    // index of the first entry matching value, -1 if there is none
+    template<typename T, size_t N> static constexpr int lgap_table_index(const T (&table)[N], T value)
+    {
+      for (size_t i = 0; i < N; i++)
+      {
+        if (table[i] == value)
+          return i;
+      }
+      return -1;
     }
 
+    static_assert(lgap_table_index(LGAP_MODES, climate::CLIMATE_MODE_HEAT) == 4, "heat is mode code 4");
+    static_assert(lgap_table_index(LGAP_FAN_MODES, climate::CLIMATE_FAN_FOCUS) + 1 == 6, "focus is sent as POWER, not SLOW+POWER");
+
     void LGAPHVACClimate::dump_config()
     {
       ESP_LOGCONFIG(TAG, "LGAP HVAC:");
       ESP_LOGCONFIG(TAG, "  Zone Number: %d", this->zone_number);
       ESP_LOGCONFIG(TAG, "  Mode: %d", (int)this->mode);
       ESP_LOGCONFIG(TAG, "  Swing: %d", (int)this->swing_mode);
-      ESP_LOGCONFIG(TAG, "  Temperature: %d", this->target_temperature);
+      ESP_LOGCONFIG(TAG, "  Temperature: %.1f", this->target_temperature);
+      ESP_LOGCONFIG(TAG, "  Max staleness (off/running): %" PRIu32 "ms / %" PRIu32 "ms", this->max_staleness_off_, this->max_staleness_running_);
+      ESP_LOGCONFIG(TAG, "  Fast poll: every %" PRIu32 "ms for %" PRIu32 "ms after a state change", this->fast_poll_interval_, this->fast_poll_duration_);
+      ESP_LOGCONFIG(TAG, "  Heartbeat: %" PRIu32 "ms, deadbands (pipe/load): %.1f / %.0f", this->heartbeat_interval_, this->pipe_temperature_deadband_, this->load_deadband_);
+      ESP_LOGCONFIG(TAG, "  Write debounce: %" PRIu32 "ms", this->write_debounce_);
+      ESP_LOGCONFIG(TAG, "  Decoded fields: %u", (unsigned) this->field_sensors_.size());
     }
 
     void LGAPHVACClimate::setup()
     {
       ESP_LOGCONFIG(TAG, "setup() setting initial HVAC state...");
 
-      // restore set points
-      auto restore = this->restore_state_();
-      if (restore.has_value())
+      // restore the last state the zone reported so home assistant has it straight away, the first poll confirms it.
+      // LGAP saves the state of all zones together, and only on control changes. while it has a record for this zone
+      // Climate::restore_state_() isn't used, so its preference never exists and the save_state_() in every
+      // publish_state() writes nothing
+      LGAPZoneState stored;
+      bool warm = this->zone_number >= 0 && this->parent_->restore_zone_state(this->zone_number, stored);
+      if (warm && !this->is_valid_zone_state(stored))
+      {
+        ESP_LOGW(TAG, "Stored state of zone %d is invalid, ignoring it", this->zone_number);
+        warm = false;
+      }
+      if (warm && !stored.has(LGAP_ZONE_STATE_LOCKS_ONLY))
+      {
+        ESP_LOGCONFIG(TAG, "Restoring the last known state of zone %d, unconfirmed until it answers...", this->zone_number);
+        this->apply_zone_state(stored);
+      }
+      else if (auto restore = this->restore_state_())
       {
         ESP_LOGCONFIG(TAG, "Restoring original state...");
         restore->apply(this);
@@ -197,13 +236,109 @@ namespace esphome
         this->preset = climate::CLIMATE_PRESET_NONE;
       }
 
+      // locks set before the zone ever answered, the rest of the state came from above
+      if (warm && stored.has(LGAP_ZONE_STATE_LOCKS_ONLY))
+      {
+        ESP_LOGCONFIG(TAG, "Restoring the locks of zone %d...", this->zone_number);
+        this->apply_zone_state(stored);
+      }
+
       // Never send nan to HA
       if (std::isnan(this->target_temperature))
       {
         this->target_temperature = 24;
       }
 
-      // todo: initialise the current temp too
+      // the built in measurement sensors are decoded by the same table walk as extra_fields, ahead of them
+      const LGAPFieldSensor built_in[] = {
+          {LGAP_FIELD_ERROR_CODE, this->error_code_sensor_, 0.0f},
+          {LGAP_FIELD_PIPE_IN, this->pipe_in_sensor_, this->pipe_temperature_deadband_},
+          {LGAP_FIELD_PIPE_OUT, this->pipe_out_sensor_, this->pipe_temperature_deadband_},
+          {LGAP_FIELD_ZONE_ACTIVE_LOAD, this->zone_active_load_sensor_, this->load_deadband_},
+          {LGAP_FIELD_ZONE_POWER_STATE, this->zone_power_state_sensor_, 0.0f},
+          {LGAP_FIELD_ZONE_DESIGN_LOAD, this->zone_design_load_sensor_, 0.0f},
+      };
+      size_t position = 0;
+      for (const auto &field : built_in)
+      {
+        if (field.sensor != nullptr)
+          this->field_sensors_.insert(this->field_sensors_.begin() + position++, field);
+      }
+
+      if (this->restored_)
+      {
+        this->publish_state();
+        const std::pair<switch_::Switch *, bool> switches[] = {
+            {this->control_lock_switch_, this->control_lock_},         {this->plasma_switch_, this->plasma_},
+            {this->lock_temperature_switch_, this->lock_temperature_}, {this->lock_fan_speed_switch_, this->lock_fan_speed_},
+            {this->lock_mode_switch_, this->lock_mode_},               {this->power_only_mode_switch_, this->power_only_mode_},
+        };
+        for (const auto &sw : switches)
+        {
+          if (sw.first != nullptr)
+            sw.first->publish_state(sw.second);
+        }
+      }
+    }
+
+    bool LGAPHVACClimate::is_valid_zone_state(const LGAPZoneState &state) const
+    {
+      if (state.has(LGAP_ZONE_STATE_LOCKS_ONLY))
+        return true;
+      return state.mode() < LGAP_MODE_COUNT && state.target_temperature >= MIN_TEMPERATURE && state.target_temperature <= MAX_TEMPERATURE;
+    }
+
+    void LGAPHVACClimate::apply_zone_state(const LGAPZoneState &state)
+    {
+      this->control_lock_ = state.has(LGAP_ZONE_STATE_CONTROL_LOCK);
+      this->plasma_ = state.has(LGAP_ZONE_STATE_PLASMA);
+      this->lock_temperature_ = state.has(LGAP_ZONE_STATE_LOCK_TEMPERATURE);
+      this->lock_fan_speed_ = state.has(LGAP_ZONE_STATE_LOCK_FAN_SPEED);
+      this->lock_mode_ = state.has(LGAP_ZONE_STATE_LOCK_MODE);
+      this->power_only_mode_ = state.has(LGAP_ZONE_STATE_POWER_ONLY_MODE);
+      this->restored_ = true;
+      if (state.has(LGAP_ZONE_STATE_LOCKS_ONLY))
+        return;
+
+      this->power_state_ = state.has(LGAP_ZONE_STATE_POWER) ? 1 : 0;
+      this->mode_ = state.mode();
+      this->swing_ = state.swing();
+      this->fan_speed_ = state.fan_speed();
+      this->target_temperature_ = state.target_temperature;
+      this->current_temperature_ = state.room_temperature;
+
+      // same mapping as a decoded frame
+      this->mode = this->power_state_ == 0 || this->mode_ >= LGAP_MODE_COUNT ? climate::CLIMATE_MODE_OFF : LGAP_MODES[this->mode_];
+      this->swing_mode = this->swing_ == 1 ? climate::CLIMATE_SWING_VERTICAL : climate::CLIMATE_SWING_OFF;
+      this->fan_mode = this->fan_speed_ == 0 ? climate::CLIMATE_FAN_AUTO : LGAP_FAN_MODES[this->fan_speed_ - 1];
+      this->target_temperature = this->target_temperature_;
+      this->current_temperature = this->current_temperature_;
+      this->control_known_ = true;
+    }
+
+    void LGAPHVACClimate::store_zone_state()
+    {
+      if (this->zone_number < 0)
+        return;
+
+      LGAPZoneState state{};
+      state.zone = this->zone_number;
+      state.flags = (this->control_lock_ ? LGAP_ZONE_STATE_CONTROL_LOCK : 0) | (this->plasma_ ? LGAP_ZONE_STATE_PLASMA : 0) |
+                    (this->lock_temperature_ ? LGAP_ZONE_STATE_LOCK_TEMPERATURE : 0) | (this->lock_fan_speed_ ? LGAP_ZONE_STATE_LOCK_FAN_SPEED : 0) |
+                    (this->lock_mode_ ? LGAP_ZONE_STATE_LOCK_MODE : 0) | (this->power_only_mode_ ? LGAP_ZONE_STATE_POWER_ONLY_MODE : 0);
+      // before the zone has answered the rest is only defaults, a lock set now is kept without them
+      if (!this->control_known_)
+      {
+        state.flags |= LGAP_ZONE_STATE_LOCKS_ONLY;
+        this->parent_->store_zone_state(state);
+        return;
+      }
+
+      state.flags |= this->power_state_ == 1 ? LGAP_ZONE_STATE_POWER : 0;
+      state.mode_fan = this->mode_ | (this->swing_ << 3) | (this->fan_speed_ << 4);
+      state.target_temperature = (uint8_t) this->target_temperature_;
+      state.room_temperature = (int8_t) this->current_temperature_;
+      this->parent_->store_zone_state(state);
     }
 
     esphome::climate::ClimateTraits LGAPHVACClimate::traits()
@@ -271,6 +406,19 @@ namespace esphome
     {
       ESP_LOGD(TAG, "esphome::climate::ClimateCall");
 
+      // every field of the call is merged into the target state first, then it goes out as one
+      // debounced write and home assistant gets a single publish
+      if (this->apply_control(call))
+      {
+        this->request_write();
+        this->publish_state();
+      }
+    }
+
+    bool LGAPHVACClimate::apply_control(const esphome::climate::ClimateCall &call)
+    {
+      bool changed = false;
+
       // Check if power-only mode is active
       if (this->power_only_mode_)
       {
@@ -284,9 +432,8 @@ namespace esphome
             if (this->mode != mode)
             {
               this->power_state_ = 0;
-              this->write_update_pending = true;
               this->mode = mode;
-              this->publish_state();
+              changed = true;
             }
           }
           else
@@ -299,7 +446,7 @@ namespace esphome
         {
           ESP_LOGW(TAG, "Control changes blocked - power-only mode is active (only ON/OFF allowed)");
         }
-        return;
+        return changed;
       }
 
       // mode
@@ -309,7 +456,7 @@ namespace esphome
         if (this->lock_mode_ && this->mode != climate::CLIMATE_MODE_OFF)
         {
           ESP_LOGW(TAG, "Mode change blocked - mode lock is active");
-          return;
+          return changed;
         }
         
         ESP_LOGD(TAG, "Mode change requested");
@@ -319,35 +466,15 @@ namespace esphome
         // anything that is not Off, needs to also set the power mode to On
         if (this->mode != mode)
         {
-
+          int code = lgap_table_index(LGAP_MODES, mode);
           if (mode == climate::CLIMATE_MODE_OFF)
           {
             this->power_state_ = 0;
           }
-          else if (mode == climate::CLIMATE_MODE_HEAT)
-          {
-            this->power_state_ = 1;
-            this->mode_ = 4;
-          }
-          else if (mode == climate::CLIMATE_MODE_DRY)
-          {
-            this->power_state_ = 1;
-            this->mode_ = 1;
-          }
-          else if (mode == climate::CLIMATE_MODE_COOL)
-          {
-            this->power_state_ = 1;
-            this->mode_ = 0;
-          }
-          else if (mode == climate::CLIMATE_MODE_FAN_ONLY)
+          else if (code >= 0)
           {
             this->power_state_ = 1;
-            this->mode_ = 2;
-          }
-          else if (mode == climate::CLIMATE_MODE_HEAT_COOL)
-          {
-            this->power_state_ = 1;
-            this->mode_ = 3;
+            this->mode_ = code;
           }
           
           // Auto-start sleep timer if AC is turning ON and timer duration is set
@@ -360,10 +487,8 @@ namespace esphome
           }
         }
 
-        // Publish updated state
-        this->write_update_pending = true;
         this->mode = mode;
-        this->publish_state();
+        changed = true;
       }
 
       // fan speed
@@ -373,7 +498,7 @@ namespace esphome
         if (this->lock_fan_speed_)
         {
           ESP_LOGW(TAG, "Fan speed change blocked - fan speed lock is active");
-          return;
+          return changed;
         }
         
         ESP_LOGD(TAG, "Fan speed change requested");
@@ -381,45 +506,13 @@ namespace esphome
 
         if (this->fan_mode != fan_mode)
         {
-          // Fan speed encoding per LG protocol:
-          // 0 = NO_CHANGE (don't use for setting)
-          // 1 = LOW
-          // 2 = MEDIUM
-          // 3 = HIGH
-          // 4 = AUTO
-          // 5 = SLOW (QUIET)
-          // 6 = POWER/TURBO
-          // 7 = SLOW+POWER (rare)
-          
-          if (fan_mode == climate::CLIMATE_FAN_LOW)
-          {
-            this->fan_speed_ = 1;
-          }
-          else if (fan_mode == climate::CLIMATE_FAN_MEDIUM)
-          {
-            this->fan_speed_ = 2;
-          }
-          else if (fan_mode == climate::CLIMATE_FAN_HIGH)
-          {
-            this->fan_speed_ = 3;
-          }
-          else if (fan_mode == climate::CLIMATE_FAN_AUTO)
-          {
-            this->fan_speed_ = 4;
-          }
-          else if (fan_mode == climate::CLIMATE_FAN_QUIET)
-          {
-            this->fan_speed_ = 5;  // SLOW mode
-          }
-          else if (fan_mode == climate::CLIMATE_FAN_FOCUS)
-          {
-            this->fan_speed_ = 6;  // TURBO/POWER mode
-          }
+          // fan codes are 1 based, see LGAP_FAN_MODES
+          int code = lgap_table_index(LGAP_FAN_MODES, fan_mode);
+          if (code >= 0)
+            this->fan_speed_ = code + 1;
 
-          // publish state
-          this->write_update_pending = true;
           this->fan_mode = fan_mode;
-          this->publish_state();
+          changed = true;
         }
       }
 
@@ -445,15 +538,13 @@ namespace esphome
             if (!this->supports_auto_swing_)
             {
               ESP_LOGW(TAG, "Auto swing not supported on this zone - ignoring");
-              return;
+              return changed;
             }
             this->swing_ = 1;  // Auto airflow
           }
 
-          // publish state
-          this->write_update_pending = true;
           this->swing_mode = swing_mode;
-          this->publish_state();
+          changed = true;
         }
       }
 
@@ -464,7 +555,7 @@ namespace esphome
         if (this->lock_temperature_)
         {
           ESP_LOGW(TAG, "Temperature change blocked - temperature lock is active");
-          return;
+          return changed;
         }
         
         // TODO: enable precision decimals as a yaml setting
@@ -494,24 +585,73 @@ namespace esphome
           this->target_temperature = temp;
         }
 
-        this->write_update_pending = true;
+        changed = true;
+      }
+
+      return changed;
+    }
+
+    LGAPBulkResult LGAPHVACClimate::apply_bulk(const LGAPBulkTarget &target)
+    {
+      // goes through the same path as a call from home assistant, so locks and temperature limits still apply
+      auto call = this->make_call();
+      if (target.power.has_value() && !*target.power)
+      {
+        call.set_mode(climate::CLIMATE_MODE_OFF);
+      }
+      else if (target.mode.has_value() && *target.mode < LGAP_MODE_COUNT)
+      {
+        call.set_mode(LGAP_MODES[*target.mode]);
+      }
+
+      if (target.fan_speed.has_value() && *target.fan_speed >= 1 && *target.fan_speed <= 7)
+        call.set_fan_mode(LGAP_FAN_MODES[*target.fan_speed - 1]);
+
+      if (target.target_temperature.has_value())
+        call.set_target_temperature(*target.target_temperature);
+
+      // apply_control() reports a mode or set point as changed even when it's the same, so compare before and after
+      climate::ClimateMode mode = this->mode;
+      optional<climate::ClimateFanMode> fan_mode = this->fan_mode;
+      float target_temperature = this->target_temperature_;
+      this->apply_control(call);
+      bool changed = this->mode != mode || this->fan_mode != fan_mode || this->target_temperature_ != target_temperature;
+
+      // anything still short of what was asked for was held back by a lock, the set point after clamping to the
+      // limits of the mode the zone ended up in
+      bool blocked = (call.get_mode().has_value() && this->mode != *call.get_mode()) ||
+                     (call.get_fan_mode().has_value() && this->fan_mode != call.get_fan_mode());
+      if (call.get_target_temperature().has_value())
+      {
+        float min_temperature = this->mode == climate::CLIMATE_MODE_HEAT ? MIN_TEMPERATURE : MIN_TEMPERATURE_NON_HEAT;
+        blocked |= this->target_temperature_ != clamp(*call.get_target_temperature(), min_temperature, (float) MAX_TEMPERATURE);
+      }
+
+      if (changed)
+      {
+        // the sweep is already a single command, no point debouncing it
+        this->request_write(false);
         this->publish_state();
       }
+
+      if (blocked)
+        return BULK_BLOCKED;
+      return changed ? BULK_APPLIED : BULK_UNCHANGED;
     }
 
-    void LGAPHVACClimate::handle_generate_lgap_request(std::vector<uint8_t> &message, uint8_t &request_id)
+    void LGAPHVACClimate::handle_generate_lgap_request(LGAPRequest &message, uint8_t request_id)
     {
-      ESP_LOGV(TAG, "Generating %s request message for zone %d...", (this->write_update_pending ? "WRITE" : "READ"), this->zone_number);
+      ESP_LOGVV(TAG, "Generating %s request message for zone %d...", (this->write_ready() ? "WRITE" : "READ"), this->zone_number);
 
       // only create a write request if there is a pending message
-      int write_state = this->write_update_pending ? 2 : 0;
+      int write_state = this->write_ready() ? 2 : 0;
 
       // build payload in message buffer
-      message.push_back(this->parent_->get_tx_byte_0());  // Byte 0 - configurable
-      message.push_back(0);                                // Byte 1 - always 0
-      message.push_back(request_id);                       // Byte 2 - request ID
-      message.push_back(this->zone_number);                // Byte 3 - zone number
-      
+      message.set_header(this->parent_->get_tx_byte_0());  // Byte 0 - configurable
+      message.set_command_type(0);                         // Byte 1 - always 0
+      message.set_request_id(request_id);                  // Byte 2 - request ID
+      message.set_zone(this->zone_number);                 // Byte 3 - zone number
+
       // Byte 4: Control flags (TX4 in protocol)
       // bit0: ON (power state)
       // bit1: EXE (execute / write_state)
@@ -519,38 +659,38 @@ namespace esphome
       // bit3: reserved (0)
       // bit4: Plasma ion (air purification)
       uint8_t control_flags = this->power_state_ | write_state | (this->control_lock_ ? 0x04 : 0x00) | (this->plasma_ ? 0x10 : 0x00);
-      message.push_back(control_flags);
-      
+      message.set_control_flags(control_flags);
+
       // Byte 5: Mode (bits 0-2) | Swing (bits 3-4) | Fan Speed (bits 4-6)
       // swing_ values: 0=OFF, 1=VERTICAL, 2=AUTO
-      message.push_back(this->mode_ | (this->swing_ << 3) | (this->fan_speed_ << 4));
-      message.push_back((uint8_t)(this->target_temperature_ - 15));
+      message.set_mode_fan(this->mode_ | (this->swing_ << 3) | (this->fan_speed_ << 4));
+      message.set_target_temperature_raw((uint8_t)(this->target_temperature_ - 15));
 
-      // blank val for checksum then replace with calculation
-      message.push_back(0);
-      message[7] = this->parent_->calculate_checksum(message);
+      // Byte 7: checksum
+      message.seal();
     }
 
     // todo: add handling for when mode change is requested but mode is already on with another zone, ie can't choose heat when cool is already on
-    void LGAPHVACClimate::handle_on_message_received(std::vector<uint8_t> &message)
+    void LGAPHVACClimate::handle_on_message_received(const LGAPResponse &message, bool republish)
     {
-      ESP_LOGD(TAG, "Processing climate message...");
+      ESP_LOGV(TAG, "Processing climate message...");
 
       // handle bad class config
       if (this->zone_number < 0)
         return;
-      if (message[4] != zone_number)
+      if (message.zone() != zone_number)
         return;
 
-      bool publish_update = false;
+      // a heartbeat republishes the climate entity even when nothing changed
+      bool publish_update = republish;
 
       // process clean message as checksum already checked before reaching this point
-      uint8_t power_state = (message[1] & 1);
-      uint8_t mode = (message[6] & 7);
+      uint8_t power_state = message.power_state();
+      uint8_t mode = message.mode();
       
       // Control lock state (message[1] bit2 based on protocol TX4 layout)
-      bool control_lock = (message[1] & 0x04) != 0;
-      if (control_lock != this->control_lock_)
+      bool control_lock = message.control_lock();
+      if (control_lock != this->control_lock_ || republish)
       {
         this->control_lock_ = control_lock;
         if (this->control_lock_switch_ != nullptr)
@@ -561,8 +701,8 @@ namespace esphome
       }
 
       // Plasma ion state (message[1] bit4 based on protocol TX4 layout)
-      bool plasma = (message[1] & 0x10) != 0;
-      if (plasma != this->plasma_)
+      bool plasma = message.plasma();
+      if (plasma != this->plasma_ || republish)
       {
         this->plasma_ = plasma;
         if (this->plasma_switch_ != nullptr)
@@ -573,21 +713,16 @@ namespace esphome
       }
 
       // Error code (TX5 / message[5]) - 0 = OK, others = service codes
-      uint8_t error_code = message[5];
-      if (this->error_code_sensor_ != nullptr)
-      {
-        this->error_code_sensor_->publish_state(error_code);
-      }
-      
+      uint8_t error_code = message.error_code();
       if (error_code != 0)
       {
         ESP_LOGW(TAG, "Zone %d error code: %d", this->zone_number, error_code);
       }
 
-      // Don't update control state from device while a write command is pending
+      // Don't update control state from device while a write command is pending or not yet echoed back
       // This prevents the device's old state from overwriting the user's new command
       // But we still want to update measurement data (temp, load byte) below
-      if (!this->write_update_pending)
+      if (!this->write_pending())
       {
         // power state and mode
         // home assistant climate treats them as a single entity
@@ -595,26 +730,9 @@ namespace esphome
         if (power_state != this->power_state_ || mode != this->mode_)
         {
           // handle mode
-          if (mode == 0)
+          if (mode < LGAP_MODE_COUNT)
           {
-            this->mode = climate::CLIMATE_MODE_COOL;
-          }
-          else if (mode == 1)
-          {
-            this->mode = climate::CLIMATE_MODE_DRY;
-          }
-          else if (mode == 2)
-          {
-            this->mode = climate::CLIMATE_MODE_FAN_ONLY;
-          }
-          else if (mode == 3)
-          {
-            // heat/cool is essentially auto
-            this->mode = climate::CLIMATE_MODE_HEAT_COOL;
-          }
-          else if (mode == 4)
-          {
-            this->mode = climate::CLIMATE_MODE_HEAT;
+            this->mode = LGAP_MODES[mode];
           }
           else
           {
@@ -629,10 +747,10 @@ namespace esphome
           }
 
           // Check if mode changes should be enforced (mode lock or power-only mode)
-          if ((this->lock_mode_ || this->power_only_mode_) && mode != this->mode_ && this->power_state_ == 1)
+          if ((this->lock_mode_ || this->power_only_mode_) && !this->restored_ && mode != this->mode_ && this->power_state_ == 1)
           {
             ESP_LOGW(TAG, "Mode changed at wall controller while lock active - reverting to previous mode");
-            this->write_update_pending = true;  // Force write to revert
+            this->request_write();  // Force write to revert
             // Don't update mode_ to keep previous value
           }
           else
@@ -649,7 +767,7 @@ namespace esphome
         // 1 = VERTICAL (automatic airflow pattern)
         // Note: Ducted IDUs have no physical vanes - this is software airflow control
         // CLIMATE_SWING_VERTICAL displays as "Vertical" in Home Assistant
-        uint8_t swing = (message[6] >> 3) & 1;
+        uint8_t swing = message.swing();
         if (swing != this->swing_)
         {
           if (swing == 0)
@@ -670,59 +788,17 @@ namespace esphome
           publish_update = true;
         }
 
-        // fan speed
-        // Fan speed decoding per LG protocol:
-        // 0 = NO_CHANGE / model-dependent (treat as no update)
-        // 1 = LOW
-        // 2 = MEDIUM
-        // 3 = HIGH
-        // 4 = AUTO
-        // 5 = SLOW (QUIET)
-        // 6 = POWER/TURBO
-        // 7 = SLOW+POWER (rare)
-        uint8_t fan_speed = ((message[6] >> 4) & 7);
-        if (fan_speed != this->fan_speed_ && fan_speed != 0)  // 0 = NO_CHANGE
+        // fan speed, 0 is NO_CHANGE / model-dependent and treated as no update. the field is 3 bits so 1-7 are all in LGAP_FAN_MODES
+        uint8_t fan_speed = message.fan_speed();
+        if (fan_speed != this->fan_speed_ && fan_speed != 0)
         {
-          if (fan_speed == 1)
-          {
-            this->fan_mode = climate::CLIMATE_FAN_LOW;
-          }
-          else if (fan_speed == 2)
-          {
-            this->fan_mode = climate::CLIMATE_FAN_MEDIUM;
-          }
-          else if (fan_speed == 3)
-          {
-            this->fan_mode = climate::CLIMATE_FAN_HIGH;
-          }
-          else if (fan_speed == 4)
-          {
-            this->fan_mode = climate::CLIMATE_FAN_AUTO;
-          }
-          else if (fan_speed == 5)
-          {
-            this->fan_mode = climate::CLIMATE_FAN_QUIET;  // SLOW mode
-          }
-          else if (fan_speed == 6)
-          {
-            this->fan_mode = climate::CLIMATE_FAN_FOCUS;  // TURBO/POWER mode
-          }
-          else if (fan_speed == 7)
-          {
-            // SLOW+POWER mode - map to FOCUS for now
-            this->fan_mode = climate::CLIMATE_FAN_FOCUS;
-            ESP_LOGW(TAG, "Received SLOW+POWER fan mode (7), mapping to TURBO");
-          }
-          else
-          {
-            ESP_LOGE(TAG, "Invalid fan speed received: %d", fan_speed);
-          }
+          this->fan_mode = LGAP_FAN_MODES[fan_speed - 1];
 
           // Check if fan speed changes should be enforced (fan speed lock or power-only mode)
-          if ((this->lock_fan_speed_ || this->power_only_mode_) && fan_speed != this->fan_speed_)
+          if ((this->lock_fan_speed_ || this->power_only_mode_) && !this->restored_ && fan_speed != this->fan_speed_)
           {
             ESP_LOGW(TAG, "Fan speed changed at wall controller while lock active - reverting to previous speed");
-            this->write_update_pending = true;  // Force write to revert
+            this->request_write();  // Force write to revert
             // Don't update fan_speed_ to keep previous value
           }
           else
@@ -737,7 +813,7 @@ namespace esphome
         // Lower nibble of message[7] holds the integer offset (0 => 15°C, 1 => 16°C, etc.)
         // This matches the LgController pattern: (buffer[6] & 0xF) + 15
         // Note: LGAP protocol may not support half-degree increments like the single-head controller
-        uint8_t raw_target = message[7] & 0x0F;
+        uint8_t raw_target = message.target_temperature_raw() & 0x0F;
         float target_temperature = static_cast<float>(raw_target + 15);
         
         // If LGAP protocol supports half-degree flag (similar to single-head), add here:
@@ -746,11 +822,11 @@ namespace esphome
         if (target_temperature != this->target_temperature_)
         {
           // Check if temperature changes should be enforced (temperature lock or power-only mode)
-          if (this->lock_temperature_ || this->power_only_mode_)
+          if ((this->lock_temperature_ || this->power_only_mode_) && !this->restored_)
           {
             ESP_LOGW(TAG, "Temperature changed at wall controller (%.0f°C→%.0f°C) while lock active - reverting", 
                      this->target_temperature_, target_temperature);
-            this->write_update_pending = true;  // Force write to revert
+            this->request_write();  // Force write to revert
             // Don't update target_temperature_ to keep previous value
           }
           else
@@ -760,7 +836,7 @@ namespace esphome
             publish_update = true;
           }
         }
-      } // end of control state update block (write_update_pending check)
+      } // end of control state update block (write_pending check)
 
       // current temp - always update measurement data
       // TODO: implement precision setting for reported temperature
@@ -768,11 +844,11 @@ namespace esphome
       // int current_temperature = (message[8] & 0xf) + 15;
       // NEW (from LG table: ~3 counts per °C, offset 192):
       // Temp(°C) = floor((192 - raw_byte) / 3)
-      uint8_t raw = message[8];
+      uint8_t raw = message.room_temperature_raw();
       int current_temperature = (192 - raw) / 3;  // integer division floors automatically
-      ESP_LOGD(TAG, "Current temperature: %d", current_temperature);
+      ESP_LOGV(TAG, "Current temperature: %d", current_temperature);
       // checks that temperature is different AND that the publish time interval has passed
-      if (current_temperature != this->current_temperature_)
+      if (current_temperature != this->current_temperature_ && !republish)
       {
         // Publish immediately on first reading (temperature_last_publish_time_ == 0)
         // or after the configured time interval has elapsed
@@ -786,46 +862,39 @@ namespace esphome
           this->temperature_last_publish_time_ = millis();
           this->current_temperature_ = current_temperature;
           this->current_temperature = current_temperature;
+          this->cancel_publish();
           publish_update = true;
         } else {
-          ESP_LOGD(TAG, "Temperature update time hasn't lapsed. Ignoring temperature difference...");
+          // keep the newest reading, it goes out when the window ends even if the temperature holds steady
+          ESP_LOGV(TAG, "Temperature update time hasn't lapsed. Holding %d until the window ends...", current_temperature);
+          this->pending_temperature_ = current_temperature;
+          this->schedule_publish(this->temperature_last_publish_time_ + this->temperature_publish_time_);
         }
       }
-
-      // Extract and decode pipe temperatures (message[9] = Pipe-In, message[10] = Pipe-Out)
-      // Using the same LG temperature mapping as room temp: Temp(°C) = (192 - raw) / 3
-      // These represent the refrigerant line temperatures for this zone
-      uint8_t raw_pipe_in = message[9];
-      uint8_t raw_pipe_out = message[10];
-      
-      float pipe_in_temp_c = lgap_raw_to_pipe_temp(raw_pipe_in);
-      float pipe_out_temp_c = lgap_raw_to_pipe_temp(raw_pipe_out);
-      
-      // Publish pipe-in temperature sensor if configured
-      if (this->pipe_in_sensor_ != nullptr)
+      else if (republish)
       {
-        this->pipe_in_sensor_->publish_state(pipe_in_temp_c);
+        // a heartbeat also catches up on a reading held back by the rate limit
+        this->temperature_last_publish_time_ = millis();
+        this->current_temperature_ = current_temperature;
+        this->current_temperature = current_temperature;
+        this->cancel_publish();
       }
-      
-      // Publish pipe-out temperature sensor if configured
-      if (this->pipe_out_sensor_ != nullptr)
+      else
       {
-        this->pipe_out_sensor_->publish_state(pipe_out_temp_c);
+        // back to the published value, nothing left to flush
+        this->cancel_publish();
       }
-      
-      ESP_LOGD(TAG, "Pipe temps - In: %.1f°C (raw: %d), Out: %.1f°C (raw: %d)", 
-               pipe_in_temp_c, raw_pipe_in, pipe_out_temp_c, raw_pipe_out);
 
       // LG LGAP Protocol - LonWorks-aligned load management bytes
       // These bytes match LG's PI485→LonWorks gateway mappings used in commercial BMS
-      // 
+      //
       // Message structure (16 bytes):
       //   0: 0x10 (frame marker)
       //   1: power state + flags
       //   2: request ID
       //   3: (reserved/unknown)
       //   4: zone number
-      //   5: (reserved/unknown)
+      //   5: error code
       //   6: mode + swing + fan
       //   7: target temp
       //   8: room temp
@@ -834,72 +903,37 @@ namespace esphome
       //   11: Zone Active Load (LonWorks: nvoLoadEstimate/nvoUnitLoad)
       //   12: Zone Power State (LonWorks: nvoOnOff) - 0=ON, 1=OFF
       //   13: Zone Design Load (LonWorks: nciRatedCapacity) - fixed design weight
-      //   14: ODU Total Load (LonWorks: nvoThermalLoad) - compressor load
+      //   14: ODU Total Load (LonWorks: nvoThermalLoad) - compressor load, LGAP hands it to LGAPOdu once per frame
       //   15: checksum
-      
-      // Byte 11: Zone Active Load (LonWorks: nvoLoadEstimate / nvoUnitLoad)
-      // Dynamic real-time per-zone thermal load estimate (0-255)
-      // - Typical idle: ~204
-      // - Under load: 80-220 range
-      // - LOWER value = HIGHER active IDU load (inverse relationship!)
-      // - Rises when zone is calling for cooling/heating
-      // - Falls as zone approaches setpoint
-      // - Proportional to design load but affected by temp delta & demand
-      uint8_t zone_active_load = message[11];
-      if (this->zone_active_load_sensor_ != nullptr)
-      {
-        this->zone_active_load_sensor_->publish_state(zone_active_load);
-      }
-      
-      // Byte 12: Zone Power State Flag (LonWorks: nvoOnOff)
-      // Simple ON/OFF state with IDU-level granularity (0-1)
-      // - 0 = RUNNING / ON
-      // - 1 = OFF / IDLE
-      // - May jitter during state transitions (ON→OFF→ON) as different boards report at different times
-      // - Multiple indoor sub-zones may share the same IDU-level ON/OFF state
-      uint8_t zone_power_state = message[12];
-      if (this->zone_power_state_sensor_ != nullptr)
-      {
-        this->zone_power_state_sensor_->publish_state(zone_power_state);
-      }
-      
-      // Byte 13: Zone Design Load Index (LonWorks: nciRatedCapacity)
-      // Fixed design load weight representing the rated capacity of this IDU
-      // - Does NOT change with on/off state
-      // - Proportional to duct size / airflow potential / nominal cooling capacity
-      // - Used by BMS to model expected capacity split among zones
-      // Example values: Small rooms: 9, Medium: 12, Large: 24
-      uint8_t zone_design_load = message[13];
-      if (this->zone_design_load_sensor_ != nullptr)
-      {
-        this->zone_design_load_sensor_->publish_state(zone_design_load);
-      }
-      
-      // Byte 14: ODU Total Load Index (LonWorks: nvoThermalLoad / nvoOduLoadFactor)
-      // ODU-level compressor load estimate (0-255)
-      // - Same value reported to all IDUs connected to the same ODU
-      // - Approximately sum of design indices (byte 13) of all ON zones, smoothed
-      // - Increases with number of active zones
-      // - Max load = sum of rated loads of connected zones
-      // - Goes to 0 when all zones are off
-      // Use (byte14 / sum_of_all_design_loads) to calculate ODU load percentage
-      // Example: All 5 downstairs zones total 78 (9+9+12+24+24), if byte14=36 → ODU at 46% load
-      uint8_t odu_total_load = message[14];
-      if (this->odu_total_load_sensor_ != nullptr)
-      {
-        this->odu_total_load_sensor_->publish_state(odu_total_load);
-      }
-      
-      ESP_LOGD(TAG, "LonWorks Load - Active: %d, Power: %d, Design: %d, ODU: %d", 
-               zone_active_load, zone_power_state, zone_design_load, odu_total_load);
+      //
+      // every measurement sensor, built in or from extra_fields, is one entry in field_sensors_. see lgap_fields.h
+      for (auto &field : this->field_sensors_)
+        publish_sensor(field.sensor, field.field.decode(message), field.deadband, republish);
 
-      // send update to home assistant with all the changed variables
+      // the restored state is confirmed or replaced now, and a control change starts a batched save
+      this->restored_ = false;
+      this->control_known_ = true;
+      this->store_zone_state();
+
+      // send update to home assistant with all the changed variables, one publish per frame at most
       if (publish_update == true)
       {
         this->publish_state();
       }
     }
 
+    void LGAPHVACClimate::flush_pending_publish()
+    {
+      if (this->pending_temperature_ == this->current_temperature_)
+        return;
+
+      ESP_LOGD(TAG, "Publishing held back temperature %.0f for zone %d", this->pending_temperature_, this->zone_number);
+      this->temperature_last_publish_time_ = millis();
+      this->current_temperature_ = this->pending_temperature_;
+      this->current_temperature = this->pending_temperature_;
+      this->publish_state();
+    }
+
     void LGAPHVACClimate::start_timer(float duration_minutes)
     {
       if (duration_minutes <= 0)
@@ -989,7 +1023,7 @@ namespace esphome
       if (this->control_lock_ != state)
       {
         this->control_lock_ = state;
-        this->write_update_pending = true;
+        this->request_write();
         ESP_LOGI(TAG, "Control lock %s", state ? "ENABLED" : "DISABLED");
       }
     }
@@ -1000,6 +1034,7 @@ namespace esphome
       {
         this->lock_temperature_ = state;
         ESP_LOGI(TAG, "Temperature lock %s", state ? "ENABLED" : "DISABLED");
+        this->store_zone_state();
       }
     }
 
@@ -1009,6 +1044,7 @@ namespace esphome
       {
         this->lock_fan_speed_ = state;
         ESP_LOGI(TAG, "Fan speed lock %s", state ? "ENABLED" : "DISABLED");
+        this->store_zone_state();
       }
     }
 
@@ -1018,6 +1054,7 @@ namespace esphome
       {
         this->lock_mode_ = state;
         ESP_LOGI(TAG, "Mode lock %s", state ? "ENABLED" : "DISABLED");
+        this->store_zone_state();
       }
     }
 
@@ -1027,6 +1064,7 @@ namespace esphome
       {
         this->power_only_mode_ = state;
         ESP_LOGI(TAG, "Power-only mode %s", state ? "ENABLED (only ON/OFF allowed)" : "DISABLED");
+        this->store_zone_state();
       }
     }
 
@@ -1035,7 +1073,7 @@ namespace esphome
       if (this->plasma_ != state)
       {
         this->plasma_ = state;
-        this->write_update_pending = true;
+        this->request_write();
         ESP_LOGI(TAG, "Plasma ion %s", state ? "ON" : "OFF");
       }
     }
@@ -1,11 +1,13 @@
 #include "../lgap.h"
 #include "../lgap_device.h"
+#include "../lgap_fields.h"
 
 #include "esphome/components/climate/climate.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/number/number.h"
 #include "esphome/components/button/button.h"
 #include "esphome/components/switch/switch.h"
+#include "esphome/core/automation.h"
 
 namespace esphome
 {
@@ -83,12 +85,24 @@ namespace esphome
         LGAPHVACClimate *parent_{nullptr};
     };
 
+    // fires when a zone still hasn't echoed a write after all its retries
+    class WriteFailedTrigger : public Trigger<>
+    {
+      public:
+        explicit WriteFailedTrigger(LGAPDevice *parent)
+        {
+          parent->add_on_write_failed_callback([this]() { this->trigger(); });
+        }
+    };
+
     class LGAPHVACClimate : public LGAPDevice, public climate::Climate
     {
       public:
         void dump_config() override;       
         void setup() override;
         void set_temperature_publish_time(int temperature_publish_time) { this->temperature_publish_time_ = temperature_publish_time; }
+        void set_pipe_temperature_deadband(float deadband) { this->pipe_temperature_deadband_ = deadband; }
+        void set_load_deadband(float deadband) { this->load_deadband_ = deadband; }
         void set_supports_auto_swing(bool supports) { this->supports_auto_swing_ = supports; }
         void set_supports_auto_fan(bool supports) { this->supports_auto_fan_ = supports; }
         void set_supports_quiet_fan(bool supports) { this->supports_quiet_fan_ = supports; }
@@ -149,7 +163,12 @@ namespace esphome
         void set_zone_active_load_sensor(sensor::Sensor *sensor) { this->zone_active_load_sensor_ = sensor; }
         void set_zone_power_state_sensor(sensor::Sensor *sensor) { this->zone_power_state_sensor_ = sensor; }
         void set_zone_design_load_sensor(sensor::Sensor *sensor) { this->zone_design_load_sensor_ = sensor; }
-        void set_odu_total_load_sensor(sensor::Sensor *sensor) { this->odu_total_load_sensor_ = sensor; }
+        // extra_fields, any response byte published through the same table walk as the built in sensors
+        void add_field_sensor(uint8_t byte, uint8_t mask, uint8_t shift, float scale, float offset, LGAPFieldFormula formula, sensor::Sensor *sensor,
+                              float deadband)
+        {
+          this->field_sensors_.push_back({{byte, mask, shift, scale, offset, formula}, sensor, deadband});
+        }
         virtual esphome::climate::ClimateTraits traits() override;
         virtual void control(const esphome::climate::ClimateCall &call) override;
         
@@ -158,6 +177,10 @@ namespace esphome
       protected:
         uint32_t temperature_publish_time_{300000};
         uint32_t temperature_last_publish_time_{0};
+        // newest room temperature held back by the rate limit, published when the window ends
+        float pending_temperature_{0.0f};
+        float pipe_temperature_deadband_{0.5f};
+        float load_deadband_{0.0f};
         
         bool supports_auto_swing_{false};  // Whether to expose auto swing mode
         bool supports_auto_fan_{false};    // Whether to expose auto fan speed mode
@@ -193,7 +216,8 @@ namespace esphome
         sensor::Sensor *zone_active_load_sensor_{nullptr};      // Byte 11 - LonWorks nvoLoadEstimate
         sensor::Sensor *zone_power_state_sensor_{nullptr};      // Byte 12 - LonWorks nvoOnOff
         sensor::Sensor *zone_design_load_sensor_{nullptr};      // Byte 13 - LonWorks nciRatedCapacity
-        sensor::Sensor *odu_total_load_sensor_{nullptr};        // Byte 14 - LonWorks nvoThermalLoad
+        // every measurement decoded from a frame, filled in by setup()
+        std::vector<LGAPFieldSensor> field_sensors_{};
         
         // Timer components
         TimerDurationNumber *timer_duration_number_{nullptr};
@@ -209,17 +233,23 @@ namespace esphome
         PowerOnlyModeSwitch *power_only_mode_switch_{nullptr};
         PlasmaSwitch *plasma_switch_{nullptr};
 
-        //todo: evaluate whether to use esppreferenceobject or not
-        // ESPPreferenceObject power_state_preference_; //uint8_t
-        // ESPPreferenceObject swing_preference_; //uint8_t
-        // ESPPreferenceObject mode_preference_; //uint8_t
-        // ESPPreferenceObject fan_speed_preference_; //uint8_t
+        // warm start, the state comes from the bus-wide record in LGAP, see lgap_zone_state.h. Climate::restore_state_()
+        // is the fallback without one. restored_ is set until the first frame, which is taken as-is without lock enforcement
+        bool restored_{false};
+        // mode, fan and set point came from the zone or a full record, not defaults, so they're worth storing
+        bool control_known_{false};
+        bool is_valid_zone_state(const LGAPZoneState &state) const;
+        void apply_zone_state(const LGAPZoneState &state);
+        void store_zone_state();
 
-        // optional<float> target_temperature_;
-        // optional<float> current_temperature_;
+        // merges a call into the target state, true if a write is needed
+        bool apply_control(const esphome::climate::ClimateCall &call);
+        LGAPBulkResult apply_bulk(const LGAPBulkTarget &target) override;
 
-        void handle_on_message_received(std::vector<uint8_t> &message) override;
-        void handle_generate_lgap_request(std::vector<uint8_t> &message, uint8_t &request_id) override;
+        bool is_running() const override { return this->power_state_ == 1; }
+        void handle_on_message_received(const LGAPResponse &message, bool republish) override;
+        void handle_generate_lgap_request(LGAPRequest &message, uint8_t request_id) override;
+        void flush_pending_publish() override;
       };
 
   } // namespace lgap
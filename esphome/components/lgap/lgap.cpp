@@ -3,8 +3,10 @@
 #include "climate/lgap_climate.h"
 #include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
+#include <algorithm>
 #include <cinttypes>
-#include <vector>
+#include <cmath>
+#include <cstring>
 
 namespace esphome
 {
@@ -12,10 +14,62 @@ namespace esphome
   {
     float LGAP::get_setup_priority() const { return setup_priority::DATA; }
 
+    void LGAP::setup()
+    {
+      // every device can be queued at most once, so reserving up front keeps queue_write() allocation free
+      this->write_queue_.reserve(this->devices_.size());
+
+      this->transport_->setup();
+      this->byte_time_us_ = this->transport_->get_byte_time_us();
+
+      // receive until a frame is sent
+      if (this->flow_control_pin_ != nullptr)
+      {
+        this->flow_control_pin_->setup();
+        this->flow_control_pin_->digital_write(false);
+      }
+      if (this->native_rs485_)
+      {
+        this->native_rs485_active_ = this->transport_->set_hardware_driver_enable(this->flow_control_pin_);
+        if (!this->native_rs485_active_)
+          ESP_LOGW(TAG, "native_rs485 is not available, releasing the driver enable from software instead");
+      }
+
+      // from here on the transport and the driver enable belong to the task, dump_config() shows what it was set up with
+      if (this->bus_task_enabled_)
+      {
+        this->transport_summary_ = this->transport_->get_summary();
+        this->bus_task_ = new LGAPBusTask(this->transport_, this->byte_time_us_, this->min_turnaround_);
+        if (!this->native_rs485_active_)
+          this->bus_task_->set_driver_enable_pin(this->flow_control_pin_);
+        if (!this->bus_task_->start())
+        {
+          ESP_LOGE(TAG, "Could not start the bus task, running the bus from the main loop");
+          delete this->bus_task_;
+          this->bus_task_ = nullptr;
+        }
+      }
+
+      // the task drops the driver enable itself
+      if (this->flow_control_pin_ != nullptr && !this->native_rs485_active_ && this->bus_task_ == nullptr)
+        this->release_timer_ready_ = this->setup_release_timer();
+
+      this->boot_start_time_ = millis();
+      this->boot_sweep_active_ = this->boot_sweep_;
+
+      this->stats_window_start_ = millis();
+      this->set_interval("stats", this->stats_interval_, [this]() { this->publish_stats(); });
+
+      this->setup_discovery();
+    }
+
     void LGAP::dump_config()
     {
       ESP_LOGCONFIG(TAG, "LGAP:");
-      check_uart_settings(4800);
+      if (this->bus_task_ != nullptr)
+        ESP_LOGCONFIG(TAG, "  Transport: %s, run by the bus task", this->transport_summary_.c_str());
+      else
+        this->transport_->dump_config();
 
       ESP_LOGCONFIG(TAG, "  Flow Control Pin:");
       if (this->flow_control_pin_ != nullptr)
@@ -26,197 +80,1008 @@ namespace esphome
       {
         ESP_LOGCONFIG(TAG, "Flow control pin not set.");
       }
+      if (this->native_rs485_active_)
+        ESP_LOGCONFIG(TAG, "  Driver enable: uart rs485 half duplex mode");
+      else if (this->bus_task_ != nullptr)
+        ESP_LOGCONFIG(TAG, "  Driver enable: released by the bus task after each frame");
+      else if (this->release_timer_ready_)
+        ESP_LOGCONFIG(TAG, "  Driver enable: released by a one shot timer after each frame");
+      else
+        ESP_LOGCONFIG(TAG, "  Driver enable: released after flushing each frame");
+      ESP_LOGCONFIG(TAG, "  Bus task: %s", this->bus_task_ != nullptr ? "running" : "off");
 
       ESP_LOGCONFIG(TAG, "  Loop wait time: %dms", this->loop_wait_time_);
       ESP_LOGCONFIG(TAG, "  Receive wait time: %dms", this->receive_wait_time_);
       ESP_LOGCONFIG(TAG, "  TX Byte 0: 0x%02X", this->tx_byte_0_);
-      ESP_LOGCONFIG(TAG, "  Child devices: %d", this->devices_.size());
+      ESP_LOGCONFIG(TAG, "  Max writes before read: %d", this->max_writes_before_read_);
+      ESP_LOGCONFIG(TAG, "  Max in flight: %d", this->max_in_flight_);
+      ESP_LOGCONFIG(TAG, "  Publish coalesce window: %" PRIu32 "ms", this->publish_coalesce_window_);
+      ESP_LOGCONFIG(TAG, "  Timing mode: %s", this->timing_mode_ == TIMING_MODE_WIRE ? "wire" : "fixed");
+      ESP_LOGCONFIG(TAG, "  Min turnaround: %dms", this->min_turnaround_);
+      ESP_LOGCONFIG(TAG, "  Byte time: %" PRIu32 "us", this->byte_time_us_);
+      ESP_LOGCONFIG(TAG, "  Boot sweep: %s", this->boot_sweep_ ? "on" : "off");
+      ESP_LOGCONFIG(TAG, "  Backoff: %" PRIu32 "ms doubling up to %" PRIu32 "ms, unavailable after %d failures", this->backoff_initial_, this->backoff_max_, this->unavailable_after_);
+      LOG_SENSOR("  ", "Bus Utilisation", this->bus_utilisation_sensor_);
+      LOG_SENSOR("  ", "Transaction Rate", this->transaction_rate_sensor_);
+      LOG_SENSOR("  ", "Transactions", this->transactions_sensor_);
+      LOG_SENSOR("  ", "Timeouts", this->timeouts_sensor_);
+      LOG_SENSOR("  ", "Checksum Failures", this->checksum_failures_sensor_);
+      LOG_SENSOR("  ", "Resyncs", this->resyncs_sensor_);
+      LOG_SENSOR("  ", "Out Of Order", this->out_of_order_sensor_);
+      LOG_SENSOR("  ", "Latency p50", this->latency_p50_sensor_);
+      LOG_SENSOR("  ", "Latency p95", this->latency_p95_sensor_);
+      LOG_SENSOR("  ", "Latency Max", this->latency_max_sensor_);
+      LOG_SENSOR("  ", "Time To Full State", this->time_to_full_state_sensor_);
+
+      ESP_LOGCONFIG(TAG, "  Bus: %" PRIu32 " transactions, %" PRIu32 " timeouts, %" PRIu32 " checksum failures, %" PRIu32 " resyncs, %" PRIu32 " out of order",
+                    this->counters_.transactions, this->counters_.timeouts, this->counters_.checksum_failures, this->counters_.resyncs, this->counters_.out_of_order);
+      for (auto *device : this->devices_)
+        device->dump_stats();
+      ESP_LOGCONFIG(TAG, "  Child devices: %u", (unsigned) this->devices_.size());
+      this->odu_.dump_config();
+      ESP_LOGCONFIG(TAG, "  Frame trace: %d records", this->trace_.get_size());
+      this->dump_discovery();
+      ESP_LOGCONFIG(TAG, "  Warm start: %s", this->warm_start_ ? "on" : "off");
+      if (this->warm_start_)
+        ESP_LOGCONFIG(TAG, "    State save delay: %" PRIu32 "ms, %d zones stored", this->state_save_delay_, this->zone_states_.count);
       if (this->debug_ == true)
       {
         ESP_LOGCONFIG(TAG, "  Debug: true");
       }
     }
 
-    // the checksum method is the same as the LG wall controller
-    // borrowed this checksum function from:
-    // https://github.com/JanM321/esphome-lg-controller/blob/998b78a212f798267feca0a91475726516228b56/esphome/lg-controller.h#L631C1-L637C6
-    uint8_t LGAP::calculate_checksum(const std::vector<uint8_t> &data)
+    void LGAP::set_min_read_share(float share)
     {
-      size_t result = 0;
-      for (size_t i = 0; i < data.size() - 1; i++)
+      // a read share of s allows (1 - s) / s writes per read, always at least one so writes can't be starved either
+      if (share <= 0.0f)
       {
-        result += data[i];
+        this->max_writes_before_read_ = UINT8_MAX;
+        return;
       }
-      return (result & 0xff) ^ 0x55;
+      float writes = (1.0f - share) / share;
+      this->max_writes_before_read_ = writes < 1.0f ? 1 : (writes > UINT8_MAX ? UINT8_MAX : (uint8_t) writes);
     }
 
-    void LGAP::clear_rx_buffer()
+    void LGAP::queue_write(LGAPDevice *device)
     {
-      ESP_LOGV(TAG, "Clearing rx buffer...");
+      for (auto *queued : this->write_queue_)
+      {
+        if (queued == device)
+          return;
+      }
 
-      // clear internal rx buffer
-      this->rx_buffer_.clear();
-      // clear uart rx buffer
-      while (this->available())
-        this->read();
+      ESP_LOGV(TAG, "Queueing write for zone %d", device->zone_number);
+      this->write_queue_.push_back(device);
     }
 
-    void LGAP::loop()
+    void LGAP::schedule_flush(uint32_t due)
     {
-      // do nothing if there are no LGAP devices registered
-      if (this->devices_.size() == 0)
+      // an earlier flush picks this one up as well
+      if (this->flush_scheduled_ && (int32_t)(due - this->flush_at_) >= 0)
         return;
 
-      if (this->state_ == State::REQUEST_NEXT_DEVICE_STATUS)
+      int32_t delay = (int32_t)(due - millis());
+      this->flush_at_ = due;
+      this->flush_scheduled_ = true;
+      this->set_timeout("flush", delay > 0 ? delay : 0, [this]() { this->flush_publishes(); });
+    }
+
+    void LGAP::flush_publishes()
+    {
+      this->flush_scheduled_ = false;
+
+      // everything due now or shortly after goes out together, so zones with windows ending close
+      // together share one flush instead of waking up for each
+      uint32_t now = millis();
+      uint8_t flushed = 0;
+      bool has_next = false;
+      uint32_t next = 0;
+      for (auto *device : this->devices_)
       {
-        // enable wait time between loops
-        if ((millis() - this->last_loop_time_) < this->loop_wait_time_)
-          return;
-        else
-          this->last_loop_time_ = millis();
+        if (!device->publish_pending_)
+          continue;
 
-        ESP_LOGV(TAG, "REQUEST_NEXT_DEVICE_STATUS");
+        int32_t until_due = (int32_t)(device->publish_due_ - now);
+        if (until_due <= (int32_t) this->publish_coalesce_window_)
+        {
+          device->publish_pending_ = false;
+          device->flush_pending_publish();
+          flushed++;
+        }
+        else if (!has_next || (int32_t)(device->publish_due_ - next) < 0)
+        {
+          has_next = true;
+          next = device->publish_due_;
+        }
+      }
 
-        // cycle through zones
-        this->last_zone_checked_index_ = (this->last_zone_checked_index_ + 1) > this->devices_.size() - 1 ? 0 : this->last_zone_checked_index_ + 1;
-        ESP_LOGV(TAG, "devices_[%d]->zone_number = %d", this->last_zone_checked_index_, this->devices_[this->last_zone_checked_index_]->zone_number);
+      ESP_LOGV(TAG, "Flushed %d held back updates", flushed);
+      if (has_next)
+        this->schedule_flush(next);
+    }
 
-        // retrieve lgap message from device if it has a valid zone number
-        if (this->devices_[this->last_zone_checked_index_]->zone_number > -1)
+    void LGAP::dequeue_write(LGAPDevice *device)
+    {
+      for (auto it = this->write_queue_.begin(); it != this->write_queue_.end(); ++it)
+      {
+        if (*it == device)
         {
-          ESP_LOGV(TAG, "Requesting update from zone %d", this->devices_[this->last_zone_checked_index_]->zone_number);
+          this->write_queue_.erase(it);
+          return;
+        }
+      }
+    }
+
+    LGAPDevice *LGAP::next_write_device()
+    {
+      // drop entries whose write has already gone out through a regular poll, or that were changed again
+      // and are back in their debounce window, they're queued again when it closes
+      while (!this->write_queue_.empty() && !this->write_queue_.front()->write_ready())
+        this->write_queue_.erase(this->write_queue_.begin());
 
-          this->tx_buffer_.clear();
-          this->devices_[this->last_zone_checked_index_]->generate_lgap_request(this->tx_buffer_, this->last_request_id_);
+      if (this->write_queue_.empty())
+        return nullptr;
 
-          // signal flow control write mode enabled
-          if (this->flow_control_pin_ != nullptr)
-            this->flow_control_pin_->digital_write(true);
+      // reads are owed their share of the bus, except during a bulk sweep, and a zone with a request outstanding waits for its answer
+      LGAPDevice *device = this->write_queue_.front();
+      if ((this->writes_since_read_ >= this->max_writes_before_read_ && !device->bulk_pending_) || device->in_flight_)
+        return nullptr;
 
-          // send data over uart
-          this->write_array(this->tx_buffer_.data(), this->tx_buffer_.size());
-          this->flush();
-          this->tx_buffer_.clear();
+      return device;
+    }
 
-          // signal flow control write mode disabled
-          if (this->flow_control_pin_ != nullptr)
-            this->flow_control_pin_->digital_write(false);
+    LGAPDevice *LGAP::next_readback_device()
+    {
+      for (auto *device : this->devices_)
+      {
+        if (device->readback_due_ && !device->in_backoff() && !device->in_flight_ && !device->write_update_pending)
+          return device;
+      }
+      return nullptr;
+    }
 
-          // update device state
-          if (this->devices_[this->last_zone_checked_index_]->write_update_pending == true)
-          {
-            ESP_LOGV(TAG, "Disabling write flag for zone %d", this->devices_[this->last_zone_checked_index_]->zone_number);
-            this->devices_[this->last_zone_checked_index_]->write_update_pending = false;
-          }
+    LGAPDevice *LGAP::next_poll_device()
+    {
+      // pick the zone that is the furthest past its freshness target, zones that were never polled are always overdue
+      uint32_t now = millis();
+      LGAPDevice *best = nullptr;
+      uint32_t best_overdue = 0;
+      for (auto *device : this->devices_)
+      {
+        if (device->zone_number < 0 || device->in_backoff() || device->in_flight_)
+          continue;
 
-          // update state for last request
-          this->last_request_zone_ = this->devices_[this->last_zone_checked_index_]->zone_number;
-          this->receive_until_time_ = millis() + this->receive_wait_time_;
+        uint32_t since_request = now - device->last_request_time_;
+        uint32_t interval = device->get_poll_interval();
+        if (device->last_request_time_ != 0 && since_request < interval)
+          continue;
 
-          // update state machine
-          this->state_ = State::PROCESS_DEVICE_STATUS_START;
+        uint32_t overdue = device->last_request_time_ == 0 ? UINT32_MAX : since_request - interval;
+        if (best == nullptr || overdue > best_overdue)
+        {
+          best = device;
+          best_overdue = overdue;
         }
+      }
+
+      return best;
+    }
+
+    LGAPDevice *LGAP::next_sweep_device()
+    {
+      // every zone gets its first poll before any gets a second, backoff is ignored so a silent zone is
+      // retried straight away and marked unavailable within the sweep
+      LGAPDevice *best = nullptr;
+      for (auto *device : this->devices_)
+      {
+        if (device->zone_number < 0 || device->has_response_ || device->in_flight_ || device->consecutive_failures_ >= this->unavailable_after_)
+          continue;
+        if (best == nullptr || (!device->swept_ && best->swept_) ||
+            (device->swept_ == best->swept_ && device->consecutive_failures_ < best->consecutive_failures_))
+          best = device;
+      }
+      return best;
+    }
 
-        // will overflow back to 0 when it reaches the top
-        // todo: implement this properly in the protocol
-        // this->last_request_id_++;
+    void LGAP::check_full_state()
+    {
+      if (this->full_state_reached_)
         return;
+
+      // full state is every zone with real data or shown unavailable
+      uint8_t answered = 0;
+      for (auto *device : this->devices_)
+      {
+        if (device->zone_number < 0)
+          continue;
+        if (device->has_response_)
+          answered++;
+        else if (device->consecutive_failures_ < this->unavailable_after_)
+          return;
+      }
+
+      // the regular scheduler takes it from here
+      uint32_t elapsed = millis() - this->boot_start_time_;
+      ESP_LOGI(TAG, "Full state after %" PRIu32 "ms, %d zones answered", elapsed, answered);
+      this->full_state_reached_ = true;
+      this->boot_sweep_active_ = false;
+      if (this->time_to_full_state_sensor_ != nullptr)
+        this->time_to_full_state_sensor_->publish_state(elapsed);
+    }
+
+    uint32_t LGAP::get_response_timeout() const
+    {
+      if (this->timing_mode_ != TIMING_MODE_WIRE || std::isnan(this->response_latency_avg_))
+        return this->receive_wait_time_;
+
+      // twice the typical ODU latency, the time the response takes on the wire and a few byte times of slack
+      uint32_t rx_time = (LGAP_RESPONSE_LENGTH + 4) * this->byte_time_us_ / 1000;
+      uint32_t timeout = (uint32_t)(2.0f * this->response_latency_avg_) + rx_time + 10;
+      return std::min<uint32_t>(timeout, this->receive_wait_time_);
+    }
+
+    uint8_t LGAP::next_request_id()
+    {
+      // rotate through the ids the ODU answers, skipping any still waiting in the table
+      uint8_t id = this->next_request_id_;
+      for (uint8_t tries = 0; tries <= 0xFF - LGAP_REQUEST_ID_MIN; tries++)
+      {
+        id = this->next_request_id_;
+        this->next_request_id_ = id == 0xFF ? LGAP_REQUEST_ID_MIN : id + 1;
+        if (this->find_in_flight(id) == nullptr)
+          break;
       }
+      return id;
+    }
 
-      // handle reading timeouts
-      if ((this->receive_until_time_ - millis()) > this->receive_wait_time_)
+    LGAPInFlight *LGAP::find_in_flight(uint8_t request_id)
+    {
+      for (auto &entry : this->in_flight_)
       {
-        ESP_LOGE(TAG, "Last receive time exceeded. Clearing buffer...");
-        clear_rx_buffer();
+        if (entry.state != IN_FLIGHT_FREE && entry.request_id == request_id)
+          return &entry;
+      }
+      return nullptr;
+    }
+
+    LGAPInFlight *LGAP::find_in_flight(uint8_t request_id, uint8_t zone)
+    {
+      LGAPInFlight *entry = this->find_in_flight(request_id);
+      return entry != nullptr && entry->zone == zone ? entry : nullptr;
+    }
+
+    LGAPInFlight *LGAP::oldest_pending(int zone)
+    {
+      LGAPInFlight *oldest = nullptr;
+      for (auto &entry : this->in_flight_)
+      {
+        if (entry.state != IN_FLIGHT_PENDING || (zone > -1 && entry.zone != zone))
+          continue;
+        if (oldest == nullptr || (int32_t)(entry.tx_end_time - oldest->tx_end_time) < 0)
+          oldest = &entry;
+      }
+      return oldest;
+    }
 
+    void LGAP::update_state()
+    {
+      if (this->receiver_.length() > 0)
+        this->state_ = State::PROCESS_DEVICE_STATUS_CONTINUE;
+      else if (this->in_flight_count_ > 0)
+        this->state_ = State::PROCESS_DEVICE_STATUS_START;
+      else
         this->state_ = State::REQUEST_NEXT_DEVICE_STATUS;
+    }
+
+    void LGAP::start_transaction(LGAPDevice *device, uint32_t timeout, bool sweep)
+    {
+      // a free slot, or failing that the late entry that has waited longest
+      LGAPInFlight *entry = nullptr;
+      for (auto &slot : this->in_flight_)
+      {
+        if (slot.state == IN_FLIGHT_FREE)
+        {
+          entry = &slot;
+          break;
+        }
+        if (slot.state == IN_FLIGHT_LATE && (entry == nullptr || (int32_t)(slot.deadline - entry->deadline) < 0))
+          entry = &slot;
+      }
+      if (entry == nullptr)
         return;
+
+      this->transmit_request();
+
+      entry->state = IN_FLIGHT_PENDING;
+      entry->request_id = this->tx_frame_.request_id();
+      entry->zone = this->tx_frame_.zone();
+      entry->device = device;
+      entry->probe = device == nullptr;
+      entry->sweep = sweep;
+      entry->rx_started = false;
+      // the frame is still going out, latency and the timeout count from when it will have finished
+      entry->tx_end_time = millis() + (this->tx_duration_us_ + 999) / 1000;
+      entry->deadline = entry->tx_end_time + timeout;
+      this->in_flight_count_++;
+
+      if (device != nullptr)
+      {
+        device->in_flight_ = true;
+        device->last_request_time_ = millis();
+      }
+      else
+      {
+        this->probing_ = true;
       }
 
-      if (this->available())
+      this->update_state();
+    }
+
+    void LGAP::expire_in_flight()
+    {
+      uint32_t now = millis();
+      for (auto &entry : this->in_flight_)
       {
-        // read byte and process
-        uint8_t c;
-        read_byte(&c);
-        ESP_LOGV(TAG, "Received Byte  %d (0X%x)", c, c);
+        if (entry.state == IN_FLIGHT_FREE || (int32_t)(now - entry.deadline) < 0)
+          continue;
 
-        // read the start of a new response
-        if (this->state_ == State::PROCESS_DEVICE_STATUS_START)
+        // nothing turned up for a late entry either, the id can be reused
+        if (entry.state == IN_FLIGHT_LATE)
         {
-          ESP_LOGV(TAG, "PROCESS_DEVICE_STATUS_START");
+          entry.state = IN_FLIGHT_FREE;
+          continue;
+        }
 
-          // handle valid start of response
-          if (c == 0x10 && this->rx_buffer_.size() == 0)
-          {
-            ESP_LOGV(TAG, "Received start of new response");
+        // most probed addresses have nothing behind them, so a silent probe is not an error
+        if (entry.probe)
+          ESP_LOGV(TAG, "No answer from zone %d", entry.zone);
+        else
+          ESP_LOGE(TAG, "No response from zone %d to request 0x%02X", entry.zone, entry.request_id);
+        this->finish_transaction(entry, OUTCOME_TIMEOUT);
+      }
+    }
 
-            this->rx_buffer_.clear();
-            this->rx_buffer_.push_back(c);
+    void LGAP::finish_transaction(LGAPInFlight &entry, TransactionOutcome outcome)
+    {
+      // frames sent and received this transaction count towards the wire busy time
+      this->stats_busy_time_us_ += (LGAP_REQUEST_LENGTH + this->receiver_.length()) * this->byte_time_us_;
+      this->stats_transactions_++;
+
+      LGAPDevice *device = entry.device;
+      LGAPCounters *zone_counters = device != nullptr ? &device->counters_ : nullptr;
+      this->counters_.transactions++;
+      if (zone_counters != nullptr)
+        zone_counters->transactions++;
+
+      switch (outcome)
+      {
+        case OUTCOME_OK:
+          this->latency_.record(this->rx_time_ - entry.tx_end_time);
+          break;
+        case OUTCOME_TIMEOUT:
+          this->trace_.record_event(TRACE_TIMEOUT, entry.request_id, entry.zone, entry.deadline);
+          // empty addresses never answer a probe, that's not a bus fault
+          if (!entry.probe)
+            this->counters_.timeouts++;
+          if (zone_counters != nullptr)
+            zone_counters->timeouts++;
+          break;
+        case OUTCOME_CHECKSUM_FAILED:
+          this->counters_.checksum_failures++;
+          if (zone_counters != nullptr)
+            zone_counters->checksum_failures++;
+          break;
+        case OUTCOME_RESYNC:
+          this->counters_.resyncs++;
+          if (zone_counters != nullptr)
+            zone_counters->resyncs++;
+          break;
+        case OUTCOME_OUT_OF_ORDER:
+          this->counters_.out_of_order++;
+          if (zone_counters != nullptr)
+            zone_counters->out_of_order++;
+          break;
+      }
 
-            this->state_ = State::PROCESS_DEVICE_STATUS_CONTINUE;
+      // only silence and a disconnected IDU count against the zone, garbled frames are a bus problem
+      if (device != nullptr)
+      {
+        device->in_flight_ = false;
+        // whatever went missing, a read-back settles whether an unconfirmed write was taken. a read-back that goes
+        // missing too counts as an attempt, so a zone that has gone quiet still runs out of retries
+        if (outcome != OUTCOME_OK && device->write_unconfirmed_)
+        {
+          if (!device->write_answered_)
+          {
+            device->write_answered_ = true;
+            device->readback_due_ = true;
           }
-          // handle invalid start of response
           else
           {
-            ESP_LOGE(TAG, "Received invalid start of response. Clearing buffer...");
-            clear_rx_buffer();
-            this->state_ = State::REQUEST_NEXT_DEVICE_STATUS;
+            device->readback_due_ = false;
+            device->retry_write();
+          }
+        }
+        if (outcome == OUTCOME_OK)
+        {
+          device->sweep_missed_ = false;
+          this->update_zone_health(device, this->receiver_.frame().idu_connected());
+        }
+        else if (outcome == OUTCOME_TIMEOUT && entry.sweep)
+        {
+          device->sweep_missed_ = true;
+        }
+        else if (outcome == OUTCOME_TIMEOUT)
+        {
+          // the next poll went unanswered as well, so the sweep's miss counts after all
+          if (device->sweep_missed_)
+          {
+            device->sweep_missed_ = false;
+            this->update_zone_health(device, false);
           }
+          this->update_zone_health(device, false);
+        }
+      }
 
-          return;
+      // probes answer the discovery scan, anything but a clean in-order response counts as no answer
+      if (entry.probe)
+      {
+        this->probing_ = false;
+        this->handle_probe_result(entry.zone, outcome == OUTCOME_OK ? &this->receiver_.frame() : nullptr);
+      }
+
+      // a timed out request stays in the table for a while so a late answer still reaches its zone
+      if (outcome == OUTCOME_TIMEOUT)
+      {
+        entry.state = IN_FLIGHT_LATE;
+        entry.deadline = millis() + this->receive_wait_time_;
+      }
+      else
+      {
+        entry.state = IN_FLIGHT_FREE;
+      }
+      this->in_flight_count_--;
+
+      // a garbled frame leaves the stream position unknown, so everything buffered goes. a timeout leaves the
+      // receiver alone, whatever is arriving may be the late answer
+      if (outcome == OUTCOME_RESYNC || outcome == OUTCOME_CHECKSUM_FAILED)
+        clear_rx_buffer();
+      else if (outcome != OUTCOME_TIMEOUT)
+        this->receiver_.reset();
+
+      this->bus_idle_since_ = millis();
+      this->update_state();
+    }
+
+    void LGAP::update_zone_health(LGAPDevice *device, bool healthy)
+    {
+      if (healthy)
+      {
+        if (device->consecutive_failures_ > 0)
+        {
+          // re-admit straight away and catch up on whatever changed while the zone was away
+          if (device->consecutive_failures_ >= this->unavailable_after_)
+            ESP_LOGI(TAG, "Zone %d is responding again", device->zone_number);
+          device->fast_poll_until_ = millis() + device->fast_poll_duration_;
         }
+        device->consecutive_failures_ = 0;
+        device->set_available(true);
+        return;
+      }
+
+      if (device->consecutive_failures_ < UINT8_MAX)
+        device->consecutive_failures_++;
+
+      if (device->consecutive_failures_ == this->unavailable_after_)
+        ESP_LOGW(TAG, "Zone %d has failed %d times in a row, marking unavailable", device->zone_number, device->consecutive_failures_);
+      if (device->consecutive_failures_ >= this->unavailable_after_)
+      {
+        device->set_available(false);
+        this->odu_.remove(device->zone_number);
+      }
+
+      if (this->backoff_initial_ == 0)
+        return;
+
+      uint8_t shift = std::min<uint8_t>(device->consecutive_failures_ - 1, 16);
+      uint32_t backoff = std::min<uint64_t>((uint64_t) this->backoff_initial_ << shift, this->backoff_max_);
+      device->backoff_until_ = millis() + backoff;
+      ESP_LOGD(TAG, "Zone %d backing off for %" PRIu32 "ms", device->zone_number, backoff);
+    }
+
+    void LGAP::publish_stats()
+    {
+      uint32_t now = millis();
+      uint32_t elapsed = now - this->stats_window_start_;
+      if (elapsed == 0)
+        return;
+
+      float utilisation = std::min(100.0f, this->stats_busy_time_us_ / (elapsed * 10.0f));
+      float rate = this->stats_transactions_ * 1000.0f / elapsed;
+      ESP_LOGD(TAG, "Bus utilisation: %.1f%%, %.2f transactions/s, response latency: %.1fms", utilisation, rate, this->response_latency_avg_);
+
+      if (this->bus_utilisation_sensor_ != nullptr)
+        this->bus_utilisation_sensor_->publish_state(utilisation);
+      if (this->transaction_rate_sensor_ != nullptr)
+        this->transaction_rate_sensor_->publish_state(rate);
+
+      ESP_LOGD(TAG, "Latency p50/p95/max: %" PRIu32 "/%" PRIu32 "/%" PRIu32 "ms over %" PRIu32 " responses, %" PRIu32 " timeouts, %" PRIu32 " checksum failures",
+               this->latency_.percentile(50), this->latency_.percentile(95), this->latency_.max(), this->latency_.count(),
+               this->counters_.timeouts, this->counters_.checksum_failures);
+
+      if (this->transactions_sensor_ != nullptr)
+        this->transactions_sensor_->publish_state(this->counters_.transactions);
+      if (this->timeouts_sensor_ != nullptr)
+        this->timeouts_sensor_->publish_state(this->counters_.timeouts);
+      if (this->checksum_failures_sensor_ != nullptr)
+        this->checksum_failures_sensor_->publish_state(this->counters_.checksum_failures);
+      if (this->resyncs_sensor_ != nullptr)
+        this->resyncs_sensor_->publish_state(this->counters_.resyncs);
+      if (this->out_of_order_sensor_ != nullptr)
+        this->out_of_order_sensor_->publish_state(this->counters_.out_of_order);
+
+      // percentiles are only meaningful with responses in the window
+      if (this->latency_.count() > 0)
+      {
+        if (this->latency_p50_sensor_ != nullptr)
+          this->latency_p50_sensor_->publish_state(this->latency_.percentile(50));
+        if (this->latency_p95_sensor_ != nullptr)
+          this->latency_p95_sensor_->publish_state(this->latency_.percentile(95));
+        if (this->latency_max_sensor_ != nullptr)
+          this->latency_max_sensor_->publish_state(this->latency_.max());
+      }
+      this->latency_.reset();
+
+      for (auto *device : this->devices_)
+        device->publish_stats();
+
+      this->stats_window_start_ = now;
+      this->stats_busy_time_us_ = 0;
+      this->stats_transactions_ = 0;
+    }
+
+    void LGAP::clear_rx_buffer()
+    {
+      ESP_LOGV(TAG, "Clearing rx buffer...");
+
+      // clear internal rx buffer
+      this->receiver_.reset();
+      // the bus task has already cleared what it had buffered when it passed the bad byte on
+      if (this->bus_task_ != nullptr)
+        return;
+      // clear the transport's rx buffer
+      this->transport_->discard_buffered();
+    }
+
+    void LGAP::loop()
+    {
+      // keeps a remote link up even with nothing to poll yet
+      if (this->bus_task_ == nullptr)
+        this->transport_->loop();
+
+      // do nothing if there are no LGAP devices registered and nothing to discover
+      if (this->devices_.size() == 0 && this->discovery_state_ == DISCOVERY_DISABLED)
+        return;
+
+      if (this->bus_task_ != nullptr)
+        this->process_bus_events();
+      else
+        this->read_transport();
+
+      this->expire_in_flight();
+      this->check_bulk();
+      this->check_full_state();
+
+      // the bus is half duplex, only start a request once our own frame is out and the line is quiet
+      if (!this->check_transmit())
+        return;
+      if (this->receiver_.length() > 0 || this->in_flight_count_ >= this->max_in_flight_)
+        return;
+
+      // give the ODU its quiet time after the last frame, the bus task does both of these itself
+      if (this->bus_task_ == nullptr)
+      {
+        if (this->transport_->available() > 0)
+          return;
+        if ((millis() - this->bus_idle_since_) < this->min_turnaround_)
+          return;
+      }
 
-        if (this->state_ == State::PROCESS_DEVICE_STATUS_CONTINUE)
+      this->send_next();
+    }
+
+    void LGAP::read_transport()
+    {
+      // this runs with nothing outstanding too, late answers are still routed to their zone
+      this->transport_->read_frames(this->receiver_, [this](const uint8_t *chunk, size_t length, uint32_t time) {
+        this->last_rx_time_ = time;
+        this->rx_time_ = time;
+        for (size_t i = 0; i < length; i++)
         {
-          ESP_LOGV(TAG, "PROCESS_DEVICE_STATUS_CONTINUE");
+          if (!this->process_rx_byte(chunk[i]))
+            break;
+        }
+      });
 
-          // add byte to rx buffer
-          this->rx_buffer_.push_back(c);
+      uint32_t now = millis();
+      if (this->receiver_.stalled(now - this->last_rx_time_, this->byte_time_us_))
+        this->handle_stall(this->receiver_.frame().bytes(), this->receiver_.length(), now);
+    }
 
-          // valid climate responses are kmillis()n to be 16 bytes long with the first byte being 0x10 (16), response length of 16 bytes and the last byte being the checksum
-          if (this->rx_buffer_.size() == 16)
+    void LGAP::process_bus_events()
+    {
+      // everything the task has seen since the last pass, in the order it happened and with the times it happened at,
+      // so timeouts and latency come out the same however late this loop() runs
+      LGAPBusEvent event;
+      while (this->bus_task_->next_event(event))
+      {
+        switch (event.type)
+        {
+          case BUS_EVENT_TX_DONE:
           {
-            // handle bad checksum
-            if (calculate_checksum(this->rx_buffer_) != this->rx_buffer_[this->rx_buffer_.size() - 1])
+            this->tx_active_ = false;
+            this->high_freq_.stop();
+            LGAPRequest sent;
+            memcpy(sent.data.data(), event.data, sent.data.size());
+            this->trace_.record(TRACE_TX, TRACE_OK, sent.bytes(), sent.size(), event.start_time);
+            // the request may have waited for a quiet line, its timeout counts from when it actually went out
+            LGAPInFlight *entry = this->find_in_flight(sent.request_id(), sent.zone());
+            if (entry != nullptr && entry->state == IN_FLIGHT_PENDING)
             {
-              // todo: include response bytes in printout
-              ESP_LOGD(TAG, "Checksum failed for response");
-              clear_rx_buffer();
-
-              this->state_ = State::REQUEST_NEXT_DEVICE_STATUS;
-              return;
+              uint32_t timeout = entry->deadline - entry->tx_end_time;
+              entry->tx_end_time = event.time;
+              entry->deadline = event.time + timeout;
             }
+            break;
+          }
+
+          case BUS_EVENT_STALL:
+            this->handle_stall(event.data, event.length, event.time);
+            break;
 
-            // TODO: add a flag to ignore out of order responses
-            // check to see if the response is for the last request (request/response is in order)
-            if (this->rx_buffer_[4] == this->last_request_zone_ && (this->rx_buffer_[2] == (this->last_request_id_ - 1) || this->rx_buffer_[2] == (this->last_request_id_)))
+          case BUS_EVENT_RX:
+            // the same byte by byte path as reading the transport directly, each event ends with the byte that
+            // completed or broke the frame
+            for (uint8_t i = 0; i < event.length; i++)
             {
-              // notify valid device components
-              for (auto &device : this->devices_)
-              {
-                if (device->zone_number == this->rx_buffer_[4])
-                {
-                  ESP_LOGD(TAG, "Valid message. Notifying zone %d...", this->last_request_zone_);
-                  device->on_message_received(this->rx_buffer_);
-                }
-              }
+              this->rx_time_ = i == 0 ? event.start_time : event.time;
+              if (!this->process_rx_byte(event.data[i]))
+                break;
             }
-            else
+            break;
+        }
+      }
+
+      uint32_t dropped = this->bus_task_->get_dropped();
+      if (dropped != this->bus_task_dropped_)
+      {
+        ESP_LOGW(TAG, "Main loop fell behind the bus task, %" PRIu32 " bus events lost", dropped - this->bus_task_dropped_);
+        this->bus_task_dropped_ = dropped;
+        // one of them may have been the end of the frame being sent
+        this->tx_active_ = false;
+        this->high_freq_.stop();
+      }
+    }
+
+    void LGAP::handle_stall(const uint8_t *data, uint8_t length, uint32_t time)
+    {
+      ESP_LOGD(TAG, "Incomplete frame (%d bytes). Clearing buffer...", length);
+      this->trace_.record(TRACE_RX, TRACE_RESYNC, data, length, time);
+      this->counters_.resyncs++;
+      this->receiver_.reset();
+      this->update_state();
+    }
+
+    void LGAP::send_next()
+    {
+      uint32_t timeout = this->get_response_timeout();
+
+      // pending writes go out as soon as the bus is free
+      LGAPDevice *device = this->next_write_device();
+      if (device != nullptr)
+      {
+        ESP_LOGVV(TAG, "REQUEST_NEXT_DEVICE_STATUS (write)");
+        this->writes_since_read_++;
+      }
+      else
+      {
+        // boot sweep, zones that haven't answered yet go out back to back ahead of discovery probes and without the
+        // poll wait time. the turnaround and the usual response timeout still apply, a shorter one would only send
+        // the next request into a slow zone's late answer
+        LGAPDevice *sweep = this->boot_sweep_active_ ? this->next_sweep_device() : nullptr;
+
+        // discovery probes take turns with the polls, one probe per poll so a scan of every address doesn't starve
+        // the zones already known. with no zones configured yet they go out back to back
+        if (sweep == nullptr && (!this->probed_since_poll_ || this->devices_.empty()) && this->send_probe(timeout))
+          return;
+
+        // a zone that hasn't echoed a write is read back straight away, ahead of the poll wait and the round robin
+        LGAPDevice *readback = this->next_readback_device();
+
+        // enable wait time between polls, unless a poll is owed to keep the read share
+        // in wire timing mode the next poll starts as soon as the turnaround has passed
+        if (sweep == nullptr && readback == nullptr && this->timing_mode_ == TIMING_MODE_FIXED && this->write_queue_.empty() && (millis() - this->last_loop_time_) < this->loop_wait_time_)
+          return;
+
+        device = sweep != nullptr ? sweep : (readback != nullptr ? readback : this->next_poll_device());
+        if (device != nullptr)
+        {
+          ESP_LOGVV(TAG, sweep != nullptr ? "REQUEST_NEXT_DEVICE_STATUS (boot sweep)" : (readback != nullptr ? "REQUEST_NEXT_DEVICE_STATUS (read-back)" : "REQUEST_NEXT_DEVICE_STATUS"));
+          // any read answers an outstanding read-back
+          device->readback_due_ = false;
+          this->last_loop_time_ = millis();
+          this->writes_since_read_ = 0;
+          this->probed_since_poll_ = false;
+        }
+        else if (!this->write_queue_.empty() && !this->write_queue_.front()->in_flight_)
+        {
+          // no zone is due for a poll, so the owed read slot goes to the next write instead
+          device = this->write_queue_.front();
+          this->writes_since_read_++;
+        }
+        else
+        {
+          // every zone is within its freshness target, the bus is free for the next probe if there is one
+          this->send_probe(timeout);
+          return;
+        }
+      }
+
+      // retrieve lgap message from device if it has a valid zone number
+      if (device->zone_number < 0)
+      {
+        this->dequeue_write(device);
+        return;
+      }
+
+      ESP_LOGVV(TAG, "Requesting update from zone %d", device->zone_number);
+      device->generate_lgap_request(this->tx_frame_, this->next_request_id());
+      bool first_sweep = this->boot_sweep_active_ && !device->swept_ && !device->has_response_;
+      if (first_sweep)
+        device->swept_ = true;
+      this->start_transaction(device, timeout, first_sweep);
+
+      // update device state, a write still in its debounce window went out as a plain read
+      if (device->write_ready())
+      {
+        ESP_LOGVV(TAG, "Disabling write flag for zone %d", device->zone_number);
+        device->write_update_pending = false;
+        this->dequeue_write(device);
+      }
+    }
+
+    void LGAP::transmit_request()
+    {
+      this->tx_duration_us_ = this->tx_frame_.size() * this->byte_time_us_ + LGAP_TX_RELEASE_GUARD_US;
+      // the task sends it once the line is quiet and reports back when it's out, it's traced from there with the time
+      // it actually went out. a full queue means the request times out
+      if (this->bus_task_ != nullptr)
+      {
+        this->tx_active_ = this->bus_task_->send(this->tx_frame_);
+        if (this->tx_active_)
+          this->high_freq_.start();
+        else
+          ESP_LOGW(TAG, "Bus task queue is full, request to zone %d not sent", this->tx_frame_.zone());
+        return;
+      }
+
+      // signal flow control write mode enabled, in native rs485 mode the uart drives the pin itself
+      this->trace_.record(TRACE_TX, TRACE_OK, this->tx_frame_.bytes(), this->tx_frame_.size(), millis());
+      bool drive_pin = this->flow_control_pin_ != nullptr && !this->native_rs485_active_;
+      if (drive_pin)
+        this->flow_control_pin_->digital_write(true);
+
+      // the frame drains from the uart fifo on its own, the release timer drops the driver enable once the last stop
+      // bit has had time to go out. the pin can't be left to loop(), a late pass would talk over the ODU's answer
+      this->transport_->write_array(this->tx_frame_.bytes(), this->tx_frame_.size());
+      this->tx_start_us_ = micros();
+      this->tx_active_ = true;
+      this->high_freq_.start();
+      if (!drive_pin || this->start_release_timer())
+        return;
+
+      // no timer on this platform, wait for the frame to leave the wire the way the component always used to
+      this->transport_->flush();
+      uint32_t elapsed = micros() - this->tx_start_us_;
+      if (elapsed < this->tx_duration_us_)
+        delayMicroseconds(this->tx_duration_us_ - elapsed);
+      this->flow_control_pin_->digital_write(false);
+    }
+
+    bool LGAP::check_transmit()
+    {
+      if (!this->tx_active_)
+        return true;
+      // cleared by the task's BUS_EVENT_TX_DONE
+      if (this->bus_task_ != nullptr)
+        return false;
+      // the pin goes down from the timer callback, never from here
+      if ((micros() - this->tx_start_us_) < this->tx_duration_us_ || !this->tx_released_.load(std::memory_order_acquire))
+        return false;
+
+      this->tx_active_ = false;
+      this->high_freq_.stop();
+      this->bus_idle_since_ = millis();
+      return true;
+    }
+
+    bool LGAP::setup_release_timer()
+    {
+#if defined(USE_ESP32)
+      // dispatched from the esp_timer task, which preempts the main loop
+      esp_timer_create_args_t args{};
+      args.callback = &LGAP::release_driver_enable;
+      args.arg = this;
+      args.name = "lgap_de";
+      if (esp_timer_create(&args, &this->release_timer_) != ESP_OK)
+      {
+        ESP_LOGW(TAG, "Could not create the driver enable timer, flushing each frame instead");
+        return false;
+      }
+      return true;
+#elif defined(USE_ESP8266)
+      os_timer_setfn(&this->release_timer_, &LGAP::release_driver_enable, this);
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    bool LGAP::start_release_timer()
+    {
+      if (!this->release_timer_ready_)
+        return false;
+
+      this->tx_released_.store(false, std::memory_order_release);
+#if defined(USE_ESP32)
+      if (esp_timer_start_once(this->release_timer_, this->tx_duration_us_) == ESP_OK)
+        return true;
+#elif defined(USE_ESP8266)
+      // millisecond resolution, rounded up so the last stop bit is always out
+      os_timer_arm(&this->release_timer_, (this->tx_duration_us_ + 999) / 1000, false);
+      return true;
+#endif
+      this->tx_released_.store(true, std::memory_order_release);
+      return false;
+    }
+
+    void LGAP::release_driver_enable(void *arg)
+    {
+      // runs outside the main loop, it only touches the pin and the flag check_transmit() waits on
+      auto *lgap = static_cast<LGAP *>(arg);
+      lgap->flow_control_pin_->digital_write(false);
+      lgap->tx_released_.store(true, std::memory_order_release);
+    }
+
+    bool LGAP::process_rx_byte(uint8_t c)
+    {
+      bool first_byte = this->receiver_.length() == 0;
+
+      switch (this->receiver_.push(c))
+      {
+        case RECEIVE_NEED_MORE:
+          // read the start of a new response
+          if (first_byte)
+          {
+            ESP_LOGVV(TAG, "Received start of new response");
+
+            // responses normally come back in request order, so the latency is measured against the oldest request.
+            // the first byte has been on the wire for one byte time already
+            LGAPInFlight *entry = this->oldest_pending();
+            if (entry != nullptr && !entry->rx_started)
             {
-              ESP_LOGD(TAG, "Response does not match last request ID. Ignoring...");
-              ESP_LOGV(TAG, "rx_buffer[2] (%d) == last_request_id_   (%d)", this->rx_buffer_[2], (this->last_request_id_ - 1));
-              ESP_LOGV(TAG, "rx_buffer[4] (%d) == last_request_zone_ (%d)", this->rx_buffer_[4], this->last_request_zone_);
+              entry->rx_started = true;
+              uint32_t byte_time = this->byte_time_us_ / 1000;
+              uint32_t elapsed = this->rx_time_ - entry->tx_end_time;
+              float latency = elapsed > byte_time ? elapsed - byte_time : 0;
+              this->response_latency_avg_ = std::isnan(this->response_latency_avg_) ? latency : this->response_latency_avg_ * 0.875f + latency * 0.125f;
             }
 
-            // reset state
-            clear_rx_buffer();
-            this->state_ = State::REQUEST_NEXT_DEVICE_STATUS;
-            return;
+            this->update_state();
           }
+          return true;
+
+        // handle invalid start of response
+        case RECEIVE_BAD_HEADER:
+          ESP_LOGE(TAG, "Received invalid start of response. Clearing buffer...");
+          this->trace_.record(TRACE_RX, TRACE_RESYNC, &c, 1, this->rx_time_);
+          this->fail_oldest(OUTCOME_RESYNC);
+          return false;
+
+        // handle bad checksum
+        case RECEIVE_BAD_CHECKSUM:
+          // the bytes themselves are in the frame trace
+          ESP_LOGD(TAG, "Checksum failed for response");
+          this->trace_.record(TRACE_RX, TRACE_CHECKSUM_FAILED, this->receiver_.frame().bytes(), LGAP_RESPONSE_LENGTH, this->rx_time_);
+          this->fail_oldest(OUTCOME_CHECKSUM_FAILED);
+          return false;
+
+        // valid climate responses are known to be 16 bytes long with the first byte being 0x10 (16) and the last byte being the checksum
+        case RECEIVE_FRAME_COMPLETE:
+          break;
+      }
+
+      const LGAPResponse &frame = this->receiver_.frame();
+      LGAPInFlight *entry = this->find_in_flight(frame.request_id(), frame.zone());
+
+      if (entry == nullptr)
+      {
+        ESP_LOGD(TAG, "Response from zone %d with request ID 0x%02X matches no request. Ignoring...", frame.zone(), frame.request_id());
+        this->trace_.record(TRACE_RX, TRACE_UNMATCHED, frame.bytes(), frame.size(), this->rx_time_);
+
+        // the zone answered, just not to what was asked, so its outstanding request won't be answered either
+        LGAPInFlight *pending = this->oldest_pending(frame.zone());
+        if (pending != nullptr)
+        {
+          this->finish_transaction(*pending, OUTCOME_OUT_OF_ORDER);
+        }
+        else
+        {
+          this->counters_.out_of_order++;
+          this->receiver_.reset();
+          this->update_state();
+        }
+        return true;
+      }
+
+      this->trace_.record(TRACE_RX, entry->state == IN_FLIGHT_PENDING ? TRACE_OK : TRACE_LATE, frame.bytes(), frame.size(), this->rx_time_);
+
+      // the ODU-wide bytes are the same in every frame, they're taken once here instead of by each zone
+      this->odu_.ingest(frame);
+
+      // notify valid device components
+      for (auto &device : this->devices_)
+      {
+        if (device->zone_number == frame.zone())
+        {
+          ESP_LOGV(TAG, "Valid message. Notifying zone %d...", frame.zone());
+          device->on_message_received(frame);
         }
       }
+
+      if (entry->state == IN_FLIGHT_PENDING)
+      {
+        if (entry != this->oldest_pending())
+          ESP_LOGD(TAG, "Response for zone %d arrived ahead of an older request", frame.zone());
+        this->finish_transaction(*entry, OUTCOME_OK);
+        return true;
+      }
+
+      // the request already timed out, the answer still counts for the zone
+      ESP_LOGD(TAG, "Late response from zone %d to request 0x%02X", frame.zone(), frame.request_id());
+      this->counters_.out_of_order++;
+      if (entry->device != nullptr)
+      {
+        entry->device->counters_.out_of_order++;
+        this->update_zone_health(entry->device, frame.idu_connected());
+      }
+      if (entry->probe)
+        this->handle_late_probe(entry->zone, frame);
+
+      entry->state = IN_FLIGHT_FREE;
+      this->receiver_.reset();
+      this->bus_idle_since_ = millis();
+      this->update_state();
+      return true;
     }
 
+    void LGAP::fail_oldest(TransactionOutcome outcome)
+    {
+      // a garbled frame can't be matched to its request, charge it to the one most likely waiting for it
+      LGAPInFlight *entry = this->oldest_pending();
+      if (entry != nullptr)
+      {
+        this->finish_transaction(*entry, outcome);
+        return;
+      }
+
+      if (outcome == OUTCOME_RESYNC)
+        this->counters_.resyncs++;
+      else
+        this->counters_.checksum_failures++;
+      clear_rx_buffer();
+      this->update_state();
+    }
 
   } // namespace lgap
-} // namespace esphome
\ No newline at end of file
+} // namespace esphome
@@ -1,10 +1,30 @@
 #pragma once
 
 #include "esphome/core/component.h"
-#include "esphome/components/uart/uart.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
 #include "esphome/components/sensor/sensor.h"
+#include <array>
+#include <atomic>
+#include <string>
 #include <vector>
+#include "lgap_bulk.h"
+#include "lgap_bus_task.h"
 #include "lgap_device.h"
+#include "lgap_discovery.h"
+#include "lgap_frame.h"
+#include "lgap_odu.h"
+#include "lgap_stats.h"
+#include "lgap_trace.h"
+#include "lgap_transport.h"
+#include "lgap_zone_state.h"
+#ifdef USE_ESP32
+#include <esp_timer.h>
+#endif
+#ifdef USE_ESP8266
+#include <osapi.h>
+#endif
 
 namespace esphome
 {
@@ -19,25 +39,147 @@ namespace esphome
       PROCESS_DEVICE_STATUS_CONTINUE
     };
 
-    class LGAP : public uart::UARTDevice, public Component
+    enum TransactionOutcome
+    {
+      OUTCOME_OK,
+      OUTCOME_TIMEOUT,
+      OUTCOME_CHECKSUM_FAILED,
+      OUTCOME_RESYNC,
+      OUTCOME_OUT_OF_ORDER
+    };
+
+    enum InFlightState
+    {
+      IN_FLIGHT_FREE,
+      // sent and waiting for the answer
+      IN_FLIGHT_PENDING,
+      // timed out, kept for a while so a late answer can still be routed
+      IN_FLIGHT_LATE
+    };
+
+    // one outstanding request, matched to its response on (request_id, zone)
+    struct LGAPInFlight
+    {
+      InFlightState state{IN_FLIGHT_FREE};
+      uint8_t request_id{0};
+      uint8_t zone{0};
+      // probes have no device
+      bool probe{false};
+      // a zone's first boot sweep poll, a miss only counts against the zone once a later poll confirms it
+      bool sweep{false};
+      bool rx_started{false};
+      LGAPDevice *device{nullptr};
+      uint32_t tx_end_time{0};
+      uint32_t deadline{0};
+    };
+
+    // room for max_in_flight pending requests plus the late entries left behind by timeouts
+    static const uint8_t LGAP_IN_FLIGHT_SLOTS = 8;
+    static const uint8_t LGAP_MAX_IN_FLIGHT = 4;
+
+    enum TimingMode
+    {
+      // fixed loop_wait_time between polls and receive_wait_time for every reply
+      TIMING_MODE_FIXED,
+      // gaps and timeouts derived from the baud rate and the measured ODU response latency
+      TIMING_MODE_WIRE
+    };
+
+    class LGAP : public Component
     {
       public:
-        uint8_t calculate_checksum(const std::vector<uint8_t> &data);
         const char *const TAG = "lgap";
 
         // load this class after the UART is instantiated
         float get_setup_priority() const override;
+        // the uart, tcp bridge or loopback the bus runs over, see lgap_transport.h
+        void set_transport(LGAPTransport *transport) { this->transport_ = transport; }
+        LGAPTransport *get_transport() const { return this->transport_; }
+        // ESP32 and host only, run the wire side of the bus in its own task, see lgap_bus_task.h
+        void set_bus_task(bool bus_task) { this->bus_task_enabled_ = bus_task; }
+        void setup() override;
         void dump_config() override;
         void loop() override;
+        void on_safe_shutdown() override;
 
         void set_loop_wait_time(uint16_t time_in_ms) { this->loop_wait_time_ = time_in_ms; }
         void set_debug(bool debug) { this->debug_ = debug; }
 
         void set_flow_control_pin(GPIOPin *flow_control_pin) { this->flow_control_pin_ = flow_control_pin; }
+        // ESP32 with esp-idf and the uart transport only, the uart drives flow_control_pin in its rs485 half duplex mode
+        void set_native_rs485(bool native_rs485) { this->native_rs485_ = native_rs485; }
         void set_receive_wait_time(uint16_t time_in_ms) { this->receive_wait_time_ = time_in_ms; }
         void set_tx_byte_0(uint8_t byte) { this->tx_byte_0_ = byte; }
         uint8_t get_tx_byte_0() const { return this->tx_byte_0_; }
-        
+        void set_min_read_share(float share);
+        void set_timing_mode(TimingMode mode) { this->timing_mode_ = mode; }
+        void set_min_turnaround(uint16_t time_in_ms) { this->min_turnaround_ = time_in_ms; }
+        void set_stats_interval(uint32_t time_in_ms) { this->stats_interval_ = time_in_ms; }
+        void set_publish_coalesce_window(uint32_t time_in_ms) { this->publish_coalesce_window_ = time_in_ms; }
+        void set_max_in_flight(uint8_t max_in_flight) { this->max_in_flight_ = max_in_flight < 1 ? 1 : (max_in_flight > LGAP_MAX_IN_FLIGHT ? LGAP_MAX_IN_FLIGHT : max_in_flight); }
+        void set_backoff_initial(uint32_t time_in_ms) { this->backoff_initial_ = time_in_ms; }
+        void set_backoff_max(uint32_t time_in_ms) { this->backoff_max_ = time_in_ms; }
+        void set_unavailable_after(uint8_t failures) { this->unavailable_after_ = failures; }
+        // poll the zones back to back at boot until each has answered or is unavailable, with the usual response timeout
+        void set_boot_sweep(bool boot_sweep) { this->boot_sweep_ = boot_sweep; }
+        void set_time_to_full_state_sensor(sensor::Sensor *sensor) { this->time_to_full_state_sensor_ = sensor; }
+        void set_bus_utilisation_sensor(sensor::Sensor *sensor) { this->bus_utilisation_sensor_ = sensor; }
+        void set_transaction_rate_sensor(sensor::Sensor *sensor) { this->transaction_rate_sensor_ = sensor; }
+        void set_transactions_sensor(sensor::Sensor *sensor) { this->transactions_sensor_ = sensor; }
+        void set_timeouts_sensor(sensor::Sensor *sensor) { this->timeouts_sensor_ = sensor; }
+        void set_checksum_failures_sensor(sensor::Sensor *sensor) { this->checksum_failures_sensor_ = sensor; }
+        void set_resyncs_sensor(sensor::Sensor *sensor) { this->resyncs_sensor_ = sensor; }
+        void set_out_of_order_sensor(sensor::Sensor *sensor) { this->out_of_order_sensor_ = sensor; }
+        void set_latency_p50_sensor(sensor::Sensor *sensor) { this->latency_p50_sensor_ = sensor; }
+        void set_latency_p95_sensor(sensor::Sensor *sensor) { this->latency_p95_sensor_ = sensor; }
+        void set_latency_max_sensor(sensor::Sensor *sensor) { this->latency_max_sensor_ = sensor; }
+
+        // ODU-wide data shared by every zone on this bus
+        void set_odu_total_load_sensor(sensor::Sensor *sensor) { this->odu_.set_total_load_sensor(sensor); }
+        void set_odu_load_percent_sensor(sensor::Sensor *sensor) { this->odu_.set_load_percent_sensor(sensor); }
+        void set_odu_design_load_total_sensor(sensor::Sensor *sensor) { this->odu_.set_design_load_total_sensor(sensor); }
+        void set_odu_active_zones_sensor(sensor::Sensor *sensor) { this->odu_.set_active_zones_sensor(sensor); }
+        void set_odu_load_deadband(float deadband) { this->odu_.set_load_deadband(deadband); }
+        const LGAPOdu &get_odu() const { return this->odu_; }
+
+        // the last trace_size frames on the bus, kept raw and only formatted when dumped
+        void set_trace_size(uint16_t size) { this->trace_.set_size(size); }
+        void dump_trace() const { this->trace_.dump(TAG); }
+        void dump_trace_capture() const { this->trace_.dump_capture(); }
+        // stream every frame off the device as capture lines through the logger, see tools/lgap_capture.py
+        void set_capture_streaming(bool streaming) { this->trace_.set_streaming(streaming); }
+        const LGAPTrace &get_trace() const { return this->trace_; }
+
+        // zone discovery, probe headers are tried in the order they are added
+        void set_discovery_enabled(bool enabled) { this->discovery_state_ = enabled ? DISCOVERY_SCANNING : DISCOVERY_DISABLED; }
+        void set_discovery_key(const std::string &key);
+        void set_force_scan(bool force_scan) { this->force_scan_ = force_scan; }
+        // 0 waits as long as for a poll, see get_response_timeout()
+        void set_probe_timeout(uint16_t time_in_ms) { this->probe_timeout_ = time_in_ms; }
+        void set_reprobe_interval(uint32_t time_in_ms) { this->reprobe_interval_ = time_in_ms; }
+        void add_probe_header(uint8_t header) { this->probe_headers_.push_back(header); }
+        void set_discovered_zones_sensor(sensor::Sensor *sensor) { this->discovered_zones_sensor_ = sensor; }
+        const LGAPZoneMap &get_zone_map() const { return this->zone_map_; }
+
+        // warm start, the last decoded state of every zone is kept in flash and published at boot until
+        // each zone answers. saves are batched and only a control change (not a new room temperature) starts one
+        void set_warm_start(bool warm_start) { this->warm_start_ = warm_start; }
+        void set_state_key(const std::string &key);
+        void set_state_save_delay(uint32_t time_in_ms) { this->state_save_delay_ = time_in_ms; }
+        bool restore_zone_state(uint8_t zone, LGAPZoneState &state);
+        void store_zone_state(const LGAPZoneState &state);
+
+        // apply one target state to the zones listed, or failing that to every zone in group (TX3 high nibble),
+        // or failing that to every zone. the writes go out back to back ahead of polling, and the
+        // bulk complete callbacks get the confirmed and failed counts once every zone has settled
+        void bulk_command(const LGAPBulkTarget &target, int group, const std::vector<int> &zones);
+        void add_on_bulk_complete_callback(std::function<void(uint8_t, uint8_t)> &&callback) { this->bulk_complete_callback_.add(std::move(callback)); }
+
+        // queue a device for a write ahead of the next status poll
+        void queue_write(LGAPDevice *device);
+        // make sure a publish flush runs no later than due, see LGAPDevice::schedule_publish()
+        void schedule_flush(uint32_t due);
+
         void register_device(LGAPDevice *device)
         {
           ESP_LOGD(TAG, "Registering device");
@@ -46,31 +188,195 @@ namespace esphome
 
       protected:
         void clear_rx_buffer();
+        void read_transport();
+        void process_bus_events();
+        bool process_rx_byte(uint8_t c);
+        void handle_stall(const uint8_t *data, uint8_t length, uint32_t time);
+        void send_next();
+        void start_transaction(LGAPDevice *device, uint32_t timeout, bool sweep = false);
+        void finish_transaction(LGAPInFlight &entry, TransactionOutcome outcome);
+        void fail_oldest(TransactionOutcome outcome);
+        void expire_in_flight();
+        void update_state();
+        uint8_t next_request_id();
+        LGAPInFlight *find_in_flight(uint8_t request_id);
+        LGAPInFlight *find_in_flight(uint8_t request_id, uint8_t zone);
+        LGAPInFlight *oldest_pending(int zone = -1);
+        void update_zone_health(LGAPDevice *device, bool healthy);
+        uint32_t get_response_timeout() const;
+        void publish_stats();
+        void flush_publishes();
+        LGAPDevice *next_write_device();
+        LGAPDevice *next_readback_device();
+        LGAPDevice *next_poll_device();
+        LGAPDevice *next_sweep_device();
+        void check_full_state();
+        void dequeue_write(LGAPDevice *device);
+        void transmit_request();
+        // true once the frame is out and the driver enable released, the transmitter is idle again
+        bool check_transmit();
+        // a one shot drops the driver enable at the end of the frame however late loop() runs, false where there is none
+        bool setup_release_timer();
+        bool start_release_timer();
+        static void release_driver_enable(void *arg);
+
+        // bulk commands, see lgap_bulk.cpp
+        void check_bulk();
+
+        // zone discovery, see lgap_discovery.cpp
+        void setup_discovery();
+        void dump_discovery();
+        bool next_probe(uint8_t &zone, uint8_t &header);
+        bool send_probe(uint32_t timeout);
+        void handle_probe_result(uint8_t zone, const LGAPResponse *frame);
+        void handle_late_probe(uint8_t zone, const LGAPResponse &frame);
+        void finish_scan();
+        void save_zone_map();
 
+        // warm start, see lgap_zone_state.cpp
+        void load_zone_states();
+        void save_zone_states();
+
+        LGAPTransport *transport_{nullptr};
+        // with the bus task running, the transport belongs to it and LGAP only talks to the task
+        bool bus_task_enabled_{false};
+        LGAPBusTask *bus_task_{nullptr};
+        uint32_t bus_task_dropped_{0};
+        std::string transport_summary_{};
         GPIOPin *flow_control_pin_{nullptr};
+        bool native_rs485_{false};
+        bool native_rs485_active_{false};
+
+        // frame being sent, transmit_request() returns as soon as it's handed to the transport. loop() runs flat out
+        // meanwhile so the bus is picked up again the moment it's free
+        bool tx_active_{false};
+        uint32_t tx_start_us_{0};
+        uint32_t tx_duration_us_{0};
+        HighFrequencyLoopRequester high_freq_;
+        // cleared while the release timer is armed, set again from its callback once the pin is down
+        std::atomic<bool> tx_released_{true};
+        bool release_timer_ready_{false};
+#if defined(USE_ESP32)
+        esp_timer_handle_t release_timer_{nullptr};
+#elif defined(USE_ESP8266)
+        os_timer_t release_timer_{};
+#endif
 
         State state_{REQUEST_NEXT_DEVICE_STATUS};
         bool debug_{true};
-        int last_zone_checked_index_{-1};
 
         uint16_t loop_wait_time_{500};
         uint16_t receive_wait_time_{500};
+        uint16_t min_turnaround_{0};
+        TimingMode timing_mode_{TIMING_MODE_FIXED};
         uint8_t tx_byte_0_{0x80};
 
-        // used for keeping track of req/resp pairs
-        uint8_t last_request_id_{250};
-        uint8_t last_request_zone_{0};
+        // used for keeping track of req/resp pairs, ids rotate through LGAP_REQUEST_ID_MIN-0xFF
+        uint8_t next_request_id_{LGAP_REQUEST_ID_MIN};
+        std::array<LGAPInFlight, LGAP_IN_FLIGHT_SLOTS> in_flight_{};
+        uint8_t in_flight_count_{0};
+        uint8_t max_in_flight_{1};
 
         // timestamps
         uint32_t last_loop_time_{0};
         uint32_t last_zone_check_time_{0};
-        uint32_t receive_until_time_{0};
+        uint32_t bus_idle_since_{0};
+        uint32_t last_rx_time_{0};
+        // when the bytes being processed arrived, stamped by the bus task when it's running
+        uint32_t rx_time_{0};
+
+        // wire timing, byte_time_us_ is filled in from the transport in setup()
+        uint32_t byte_time_us_{2083};
+        float response_latency_avg_{NAN};
+
+        // bus usage since the last stats publish
+        uint32_t stats_interval_{60000};
+        uint32_t stats_window_start_{0};
+        uint32_t stats_busy_time_us_{0};
+        uint32_t stats_transactions_{0};
+        sensor::Sensor *bus_utilisation_sensor_{nullptr};
+        sensor::Sensor *transaction_rate_sensor_{nullptr};
 
-        std::vector<uint8_t> rx_buffer_;
-        std::vector<uint8_t> tx_buffer_;
+        // bus health since boot, latency percentiles per stats interval
+        LGAPCounters counters_;
+        LGAPLatencyHistogram latency_;
+        sensor::Sensor *transactions_sensor_{nullptr};
+        sensor::Sensor *timeouts_sensor_{nullptr};
+        sensor::Sensor *checksum_failures_sensor_{nullptr};
+        sensor::Sensor *resyncs_sensor_{nullptr};
+        sensor::Sensor *out_of_order_sensor_{nullptr};
+        sensor::Sensor *latency_p50_sensor_{nullptr};
+        sensor::Sensor *latency_p95_sensor_{nullptr};
+        sensor::Sensor *latency_max_sensor_{nullptr};
+
+        // held back publishes due within publish_coalesce_window_ of a flush go out with it
+        uint32_t publish_coalesce_window_{5000};
+        uint32_t flush_at_{0};
+        bool flush_scheduled_{false};
+
+        // zones that time out or report their IDU disconnected are polled less and less often, doubling
+        // from backoff_initial_ up to backoff_max_, and marked unavailable after unavailable_after_ failures
+        uint32_t backoff_initial_{1000};
+        uint32_t backoff_max_{60000};
+        uint8_t unavailable_after_{3};
+
+        // boot sweep, zones that haven't answered yet go first without the poll wait time or backoff, until every
+        // zone has answered or been marked unavailable. that's full state, timed from setup()
+        bool boot_sweep_{true};
+        bool boot_sweep_active_{false};
+        uint32_t boot_start_time_{0};
+        bool full_state_reached_{false};
+        sensor::Sensor *time_to_full_state_sensor_{nullptr};
+
+        LGAPFrameReceiver receiver_;
+        LGAPRequest tx_frame_;
+        LGAPOdu odu_;
+        LGAPTrace trace_;
 
         std::vector<LGAPDevice *> devices_{};
 
+        // pending writes are served in fifo order before any status poll, but after
+        // max_writes_before_read_ back-to-back writes a poll is forced so reads keep their share of the bus
+        std::vector<LGAPDevice *> write_queue_{};
+        uint8_t max_writes_before_read_{3};
+        uint8_t writes_since_read_{0};
+
+        // running bulk command, bulk_remaining_ counts the zones yet to confirm or give up
+        uint8_t bulk_remaining_{0};
+        uint8_t bulk_confirmed_{0};
+        uint8_t bulk_failed_{0};
+        uint32_t bulk_start_time_{0};
+        CallbackManager<void(uint8_t, uint8_t)> bulk_complete_callback_;
+
+        // zone discovery, probing_ is set while a probe is outstanding. probes take turns with the polls,
+        // probed_since_poll_ holds the next one back until a zone has been polled
+        DiscoveryState discovery_state_{DISCOVERY_DISABLED};
+        bool force_scan_{false};
+        bool probing_{false};
+        bool probed_since_poll_{false};
+        uint16_t probe_timeout_{0};
+        uint32_t reprobe_interval_{30000};
+        std::vector<uint8_t> probe_headers_{};
+        uint8_t probe_header_index_{0};
+        uint16_t scan_address_{0};
+        uint32_t scan_start_time_{0};
+        uint8_t reprobe_address_{0};
+        bool reprobe_retry_{false};
+        uint32_t last_reprobe_time_{0};
+        uint32_t discovery_key_{0};
+        LGAPZoneMap zone_map_;
+        ESPPreferenceObject zone_map_pref_;
+        sensor::Sensor *discovered_zones_sensor_{nullptr};
+
+        // warm start, zone_states_ holds every zone's last state and is saved state_save_delay_ after a control change
+        bool warm_start_{true};
+        uint32_t state_save_delay_{60000};
+        uint32_t state_key_{0};
+        bool zone_states_loaded_{false};
+        bool zone_states_save_pending_{false};
+        LGAPZoneStates zone_states_;
+        ESPPreferenceObject zone_states_pref_;
+
     };
   } // namespace lgap
 } // namespace esphome
\ No newline at end of file
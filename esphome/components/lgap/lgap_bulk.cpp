@@ -0,0 +1,154 @@
+#include "lgap.h"
+#include "lgap_bulk.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cinttypes>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // indexed by the TX5 mode code, the same order as LGAP_MODES in the climate
+    static constexpr const char *BULK_MODE_NAMES[] = {"COOL", "DRY", "FAN_ONLY", "HEAT_COOL", "HEAT"};
+    // fan code n is at index n - 1
+    static constexpr const char *BULK_FAN_MODE_NAMES[] = {"LOW", "MEDIUM", "HIGH", "AUTO", "QUIET", "FOCUS"};
+
+    bool parse_bulk_mode(const std::string &name, LGAPBulkTarget &target)
+    {
+      std::string mode = str_upper_case(name);
+      if (mode == "OFF")
+      {
+        target.power = false;
+        return true;
+      }
+
+      for (uint8_t code = 0; code < sizeof(BULK_MODE_NAMES) / sizeof(BULK_MODE_NAMES[0]); code++)
+      {
+        if (mode == BULK_MODE_NAMES[code])
+        {
+          target.power = true;
+          target.mode = code;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    bool parse_bulk_fan_mode(const std::string &name, LGAPBulkTarget &target)
+    {
+      std::string fan_mode = str_upper_case(name);
+      for (uint8_t i = 0; i < sizeof(BULK_FAN_MODE_NAMES) / sizeof(BULK_FAN_MODE_NAMES[0]); i++)
+      {
+        if (fan_mode == BULK_FAN_MODE_NAMES[i])
+        {
+          target.fan_speed = i + 1;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void LGAP::bulk_command(const LGAPBulkTarget &target, int group, const std::vector<int> &zones)
+    {
+      // a command issued while another sweep is still running extends it, the counts carry on
+      if (this->bulk_remaining_ == 0)
+      {
+        this->bulk_confirmed_ = 0;
+        this->bulk_failed_ = 0;
+        this->bulk_start_time_ = millis();
+      }
+
+      uint8_t selected = 0;
+      for (auto *device : this->devices_)
+      {
+        if (device->zone_number < 0)
+          continue;
+
+        // an explicit zone list wins over the group, neither selects every zone. TX3 carries the group in its high nibble
+        if (!zones.empty())
+        {
+          if (std::find(zones.begin(), zones.end(), device->zone_number) == zones.end())
+            continue;
+        }
+        else if (group > -1 && (device->zone_number >> 4) != group)
+        {
+          continue;
+        }
+        selected++;
+
+        // a zone known to be down would hold the whole sweep open for its backoff
+        if (device->available_known_ && !device->available_)
+        {
+          ESP_LOGW(TAG, "Zone %d is unavailable, left out of the bulk command", device->zone_number);
+          if (!device->bulk_pending_)
+            this->bulk_failed_++;
+          continue;
+        }
+
+        switch (device->apply_bulk(target))
+        {
+          case BULK_APPLIED:
+            break;
+          case BULK_UNCHANGED:
+            // already there, or still on its way there from an earlier command in this sweep
+            ESP_LOGD(TAG, "Zone %d is already in the bulk command's state", device->zone_number);
+            if (!device->bulk_pending_)
+              this->bulk_confirmed_++;
+            continue;
+          case BULK_BLOCKED:
+            ESP_LOGW(TAG, "Zone %d did not take the bulk command, its locks are on", device->zone_number);
+            if (!device->bulk_pending_)
+              this->bulk_failed_++;
+            continue;
+        }
+
+        if (!device->bulk_pending_)
+        {
+          device->bulk_pending_ = true;
+          this->bulk_remaining_++;
+        }
+      }
+
+      ESP_LOGI(TAG, "Bulk command sent to %d zones", selected);
+      if (selected == 0)
+        ESP_LOGW(TAG, "Bulk command matched no zones");
+
+      // nothing to wait for, report straight away
+      if (this->bulk_remaining_ == 0)
+        this->bulk_complete_callback_.call(this->bulk_confirmed_, this->bulk_failed_);
+    }
+
+    void LGAP::check_bulk()
+    {
+      if (this->bulk_remaining_ == 0)
+        return;
+
+      for (auto *device : this->devices_)
+      {
+        if (!device->bulk_pending_)
+          continue;
+
+        // a zone that went down mid sweep keeps its write for when it's back, but isn't waited on
+        bool lost = device->available_known_ && !device->available_;
+        if (device->write_pending() && !lost)
+          continue;
+
+        device->bulk_pending_ = false;
+        this->bulk_remaining_--;
+        if (device->write_failed_ || lost)
+          this->bulk_failed_++;
+        else
+          this->bulk_confirmed_++;
+      }
+
+      if (this->bulk_remaining_ > 0)
+        return;
+
+      ESP_LOGI(TAG, "Bulk command finished in %" PRIu32 "ms, %d zones confirmed, %d failed", millis() - this->bulk_start_time_,
+               this->bulk_confirmed_, this->bulk_failed_);
+      this->bulk_complete_callback_.call(this->bulk_confirmed_, this->bulk_failed_);
+    }
+
+  } // namespace lgap
+} // namespace esphome
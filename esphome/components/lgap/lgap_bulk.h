@@ -0,0 +1,37 @@
+#pragma once
+#include <stdint.h>
+#include <string>
+#include "esphome/core/helpers.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // one target state applied to a set of zones, fields left empty are not changed.
+    // mode and fan speed use the TX5 encoding, see protocol.md
+    struct LGAPBulkTarget
+    {
+      optional<bool> power;
+      optional<uint8_t> mode;
+      optional<uint8_t> fan_speed;
+      optional<float> target_temperature;
+    };
+
+    // what a zone made of a bulk command. only a zone whose locks kept part of it out counts as failed
+    enum LGAPBulkResult
+    {
+      // the zone's target state changed and a write is queued
+      BULK_APPLIED,
+      // the zone is already in the requested state, nothing to write
+      BULK_UNCHANGED,
+      // a lock or power-only mode blocked some of it
+      BULK_BLOCKED
+    };
+
+    // OFF, COOL, HEAT, DRY, FAN_ONLY or HEAT_COOL, any case. false if the name is unknown
+    bool parse_bulk_mode(const std::string &name, LGAPBulkTarget &target);
+    // LOW, MEDIUM, HIGH, AUTO, QUIET or FOCUS, any case. false if the name is unknown
+    bool parse_bulk_fan_mode(const std::string &name, LGAPBulkTarget &target);
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,159 @@
+#include "lgap_bus_task.h"
+#include <cstring>
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+#ifdef USE_HOST
+#include <thread>
+#endif
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // above the main loop so it gets the cpu as soon as a byte is due, below wifi and lwip
+    static const uint8_t LGAP_BUS_TASK_PRIORITY = 5;
+    static const uint32_t LGAP_BUS_TASK_STACK_SIZE = 4096;
+
+    bool LGAPBusTask::start()
+    {
+      this->line_idle_since_ = millis();
+#if defined(USE_ESP32)
+      return xTaskCreate(LGAPBusTask::run, "lgap_bus", LGAP_BUS_TASK_STACK_SIZE, this, LGAP_BUS_TASK_PRIORITY, nullptr) == pdPASS;
+#elif defined(USE_HOST)
+      std::thread(LGAPBusTask::run, this).detach();
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    void LGAPBusTask::run(void *arg)
+    {
+      auto *task = static_cast<LGAPBusTask *>(arg);
+      while (true)
+      {
+        task->run_once_();
+        // a byte takes ~2ms at 4800 baud, so 1ms between passes never lets the uart fall behind
+        delay(1);
+      }
+    }
+
+    void LGAPBusTask::run_once_()
+    {
+      this->transport_->loop();
+      this->read_();
+
+      uint32_t now = millis();
+      if (this->receiver_.stalled(now - this->last_rx_time_, this->byte_time_us_))
+      {
+        LGAPBusEvent event;
+        event.type = BUS_EVENT_STALL;
+        event.length = this->receiver_.length();
+        event.start_time = this->rx_start_time_;
+        event.time = now;
+        memcpy(event.data, this->receiver_.frame().bytes(), event.length);
+        this->receiver_.reset();
+        this->emit_(event);
+      }
+
+      if (!this->has_pending_tx_)
+        this->has_pending_tx_ = this->tx_queue_.pop(this->pending_tx_);
+      if (!this->has_pending_tx_)
+        return;
+
+      // the bus is half duplex, only send once the line is quiet and the ODU has had its turnaround
+      if (this->receiver_.length() > 0 || this->transport_->available() > 0 || (millis() - this->line_idle_since_) < this->min_turnaround_)
+        return;
+
+      this->transmit_(this->pending_tx_);
+      this->has_pending_tx_ = false;
+    }
+
+    void LGAPBusTask::read_()
+    {
+      this->transport_->read_frames(this->receiver_, [this](const uint8_t *chunk, size_t length, uint32_t time) {
+        this->last_rx_time_ = time;
+        this->line_idle_since_ = time;
+        for (size_t i = 0; i < length; i++)
+        {
+          if (this->receiver_.length() == 0)
+            this->rx_start_time_ = time;
+
+          ReceiveResult result = this->receiver_.push(chunk[i]);
+          if (result == RECEIVE_NEED_MORE)
+            continue;
+
+          LGAPBusEvent event;
+          event.type = BUS_EVENT_RX;
+          event.start_time = this->rx_start_time_;
+          event.time = time;
+          if (result == RECEIVE_BAD_HEADER)
+          {
+            event.length = 1;
+            event.data[0] = chunk[i];
+          }
+          else
+          {
+            event.length = LGAP_RESPONSE_LENGTH;
+            memcpy(event.data, this->receiver_.frame().bytes(), LGAP_RESPONSE_LENGTH);
+          }
+          this->receiver_.reset();
+          this->emit_(event);
+
+          // LGAP doesn't touch the transport while the task runs, so the task clears it after a bad frame
+          if (result != RECEIVE_FRAME_COMPLETE)
+          {
+            this->transport_->discard_buffered();
+            return;
+          }
+        }
+      });
+    }
+
+    void LGAPBusTask::transmit_(const LGAPRequest &frame)
+    {
+      uint32_t start_time = millis();
+      if (this->driver_enable_pin_ != nullptr)
+        this->driver_enable_pin_->digital_write(true);
+
+      this->transport_->write_array(frame.bytes(), frame.size());
+
+      // nothing else can happen on the bus until the frame is out, so this task just waits for the last stop bit
+      // instead of leaving the driver enable to a timer that the main loop might service late
+      uint32_t start = micros();
+      uint32_t duration = frame.size() * this->byte_time_us_ + LGAP_TX_RELEASE_GUARD_US;
+      while (true)
+      {
+        uint32_t elapsed = micros() - start;
+        if (elapsed >= duration)
+          break;
+        uint32_t remaining = duration - elapsed;
+        if (remaining > 2000)
+          delay(1);
+        else
+          delayMicroseconds(remaining);
+      }
+
+      if (this->driver_enable_pin_ != nullptr)
+        this->driver_enable_pin_->digital_write(false);
+
+      LGAPBusEvent event;
+      event.type = BUS_EVENT_TX_DONE;
+      event.length = frame.size();
+      event.start_time = start_time;
+      event.time = this->line_idle_since_ = millis();
+      memcpy(event.data, frame.bytes(), frame.size());
+      this->emit_(event);
+    }
+
+    void LGAPBusTask::emit_(const LGAPBusEvent &event)
+    {
+      // the main loop catches up with whatever is still queued, what doesn't fit is lost like an overrun uart
+      if (!this->events_.push(event))
+        this->dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+  } // namespace lgap
+} // namespace esphome
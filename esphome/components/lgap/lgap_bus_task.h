@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <stdint.h>
+#include "esphome/core/hal.h"
+#include "lgap_frame.h"
+#include "lgap_ring.h"
+#include "lgap_transport.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    enum LGAPBusEventType : uint8_t
+    {
+      // bytes off the wire, a whole response or whatever broke one (a bad header byte, a frame failing its checksum)
+      BUS_EVENT_RX,
+      // a response that stopped part way through, data holds what arrived
+      BUS_EVENT_STALL,
+      // a request finished going out, data holds the frame
+      BUS_EVENT_TX_DONE
+    };
+
+    struct LGAPBusEvent
+    {
+      LGAPBusEventType type{BUS_EVENT_RX};
+      uint8_t length{0};
+      // when the first and the last byte arrived, or when the request started and finished going out
+      uint32_t start_time{0};
+      uint32_t time{0};
+      uint8_t data[LGAP_RESPONSE_LENGTH]{};
+    };
+
+    // room for a main loop stall of several seconds at full bus speed
+    static const uint8_t LGAP_BUS_EVENT_SLOTS = 16;
+    // max_in_flight requests at most, one more slot to tell full from empty
+    static const uint8_t LGAP_BUS_TX_SLOTS = 5;
+
+    // the wire side of the bus in its own task (a FreeRTOS task on ESP32, a thread on the host build). it owns the
+    // transport and the driver enable, assembles responses and stamps them with the time they arrived, and sends
+    // requests once the line is quiet. matching, scheduling and decoding stay in LGAP::loop(), which only sees
+    // the two rings, so a stalled main loop no longer holds the driver enable on or delays a frame mid-stream
+    class LGAPBusTask
+    {
+      public:
+        LGAPBusTask(LGAPTransport *transport, uint32_t byte_time_us, uint32_t min_turnaround) : transport_(transport), byte_time_us_(byte_time_us), min_turnaround_(min_turnaround) {}
+
+        // the driver enable to raise around each request, left alone when the transport drives it in hardware
+        void set_driver_enable_pin(GPIOPin *pin) { this->driver_enable_pin_ = pin; }
+        // false where tasks aren't available
+        bool start();
+
+        // main loop side
+        bool send(const LGAPRequest &frame) { return this->tx_queue_.push(frame); }
+        bool next_event(LGAPBusEvent &event) { return this->events_.pop(event); }
+        // events thrown away because the main loop fell too far behind
+        uint32_t get_dropped() const { return this->dropped_.load(std::memory_order_relaxed); }
+
+      protected:
+        static void run(void *arg);
+        void run_once_();
+        void read_();
+        void transmit_(const LGAPRequest &frame);
+        void emit_(const LGAPBusEvent &event);
+
+        LGAPTransport *transport_;
+        GPIOPin *driver_enable_pin_{nullptr};
+        uint32_t byte_time_us_;
+        uint32_t min_turnaround_;
+
+        // task side
+        LGAPFrameReceiver receiver_;
+        uint32_t rx_start_time_{0};
+        uint32_t last_rx_time_{0};
+        uint32_t line_idle_since_{0};
+        LGAPRequest pending_tx_;
+        bool has_pending_tx_{false};
+
+        LGAPRing<LGAPBusEvent, LGAP_BUS_EVENT_SLOTS> events_;
+        LGAPRing<LGAPRequest, LGAP_BUS_TX_SLOTS> tx_queue_;
+        std::atomic<uint32_t> dropped_{0};
+    };
+
+  } // namespace lgap
+} // namespace esphome
@@ -1,5 +1,9 @@
 #include "lgap_device.h"
-#include <vector>
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
 
 namespace esphome
 {
@@ -7,14 +11,196 @@ namespace esphome
   {
     // float LGAPDevice::get_setup_priority() const { return setup_priority::DATA + 10; }
 
-    void LGAPDevice::on_message_received(std::vector<uint8_t> &message)
+    uint32_t LGAPDevice::get_poll_interval() const
     {
-      this->handle_on_message_received(message);
+      uint32_t interval = this->is_running() ? this->max_staleness_running_ : this->max_staleness_off_;
+
+      // poll faster for a while after the unit reported a state change
+      if ((int32_t)(this->fast_poll_until_ - millis()) > 0 && this->fast_poll_interval_ < interval)
+        interval = this->fast_poll_interval_;
+
+      return interval;
+    }
+
+    static const char *const TAG = "lgap.device";
+
+    bool LGAPDevice::in_backoff() const
+    {
+      return this->consecutive_failures_ > 0 && (int32_t)(this->backoff_until_ - millis()) > 0;
     }
 
-    void LGAPDevice::generate_lgap_request(std::vector<uint8_t> &message, uint8_t &request_id)
+    void LGAPDevice::set_available(bool available)
+    {
+      if (this->available_known_ && this->available_ == available)
+        return;
+
+      this->available_ = available;
+      this->available_known_ = true;
+      if (this->available_sensor_ != nullptr)
+        this->available_sensor_->publish_state(available);
+    }
+
+    void LGAPDevice::publish_stats()
+    {
+      if (this->poll_interval_sensor_ != nullptr && !std::isnan(this->poll_interval_avg_))
+        this->poll_interval_sensor_->publish_state(this->poll_interval_avg_ / 1000.0f);
+      if (this->timeouts_sensor_ != nullptr)
+        this->timeouts_sensor_->publish_state(this->counters_.timeouts);
+    }
+
+    void LGAPDevice::dump_stats()
+    {
+      ESP_LOGCONFIG(TAG, "  Zone %d: %" PRIu32 " transactions, %" PRIu32 " timeouts, %" PRIu32 " checksum failures, %" PRIu32 " resyncs, %" PRIu32 " out of order, poll interval %.0fms",
+                    this->zone_number, this->counters_.transactions, this->counters_.timeouts, this->counters_.checksum_failures,
+                    this->counters_.resyncs, this->counters_.out_of_order, this->poll_interval_avg_);
+      ESP_LOGCONFIG(TAG, "    Available: %s, consecutive failures: %d", this->available_known_ ? (this->available_ ? "yes" : "no") : "unknown", this->consecutive_failures_);
+      ESP_LOGCONFIG(TAG, "    Write retries: %d, failed writes: %" PRIu32, this->write_retries_, this->write_failures_);
+      LOG_SENSOR("    ", "Write Ack Latency", this->write_ack_latency_sensor_);
+      LOG_BINARY_SENSOR("    ", "Available", this->available_sensor_);
+    }
+
+    void LGAPDevice::on_message_received(const LGAPResponse &message)
+    {
+      // achieved poll interval, smoothed
+      uint32_t now = millis();
+      if (this->last_response_time_ != 0)
+      {
+        float interval = now - this->last_response_time_;
+        this->poll_interval_avg_ = std::isnan(this->poll_interval_avg_) ? interval : this->poll_interval_avg_ * 0.8f + interval * 0.2f;
+      }
+      this->last_response_time_ = now;
+
+      // a newer write waiting in the queue supersedes the one sent
+      if (this->write_unconfirmed_ && !this->write_update_pending)
+        this->verify_write(message);
+
+      // an identical frame carries nothing new, so skip decoding it entirely until the next heartbeat
+      bool republish = !this->has_response_ || (this->heartbeat_interval_ > 0 && (now - this->last_heartbeat_time_) >= this->heartbeat_interval_);
+      if (!republish && !this->decode_next_ && message.same_state(this->last_response_))
+      {
+        ESP_LOGV(TAG, "Zone %d unchanged, skipping decode", this->zone_number);
+        return;
+      }
+
+      // power/flags, error code, mode/fan and set point
+      if (this->has_response_ && (message.flags() != this->last_response_.flags() || message.error_code() != this->last_response_.error_code() ||
+                                  message.mode_fan() != this->last_response_.mode_fan() || message.target_temperature_raw() != this->last_response_.target_temperature_raw()))
+      {
+        this->fast_poll_until_ = millis() + this->fast_poll_duration_;
+      }
+      this->last_response_ = message;
+      this->has_response_ = true;
+      this->decode_next_ = false;
+      if (republish)
+        this->last_heartbeat_time_ = now;
+
+      this->handle_on_message_received(message, republish);
+    }
+
+    void LGAPDevice::schedule_publish(uint32_t due)
+    {
+      // a newer value replaces the pending one but keeps the original deadline
+      if (this->publish_pending_)
+        return;
+
+      this->publish_pending_ = true;
+      this->publish_due_ = due;
+      if (this->parent_ != nullptr)
+        this->parent_->schedule_flush(due);
+    }
+
+    void LGAPDevice::request_write(bool debounce)
+    {
+      // confirmation latency runs from the first change, a newer change starts the retry count over
+      if (!this->write_pending())
+        this->write_command_time_ = millis();
+      this->write_attempts_ = 0;
+      this->write_failed_ = false;
+      this->write_update_pending = true;
+      if (!debounce || this->write_debounce_ == 0)
+      {
+        this->write_debouncing_ = false;
+        this->cancel_timeout("write_debounce");
+        if (this->parent_ != nullptr)
+          this->parent_->queue_write(this);
+        return;
+      }
+
+      // every change inside the window restarts it, the write carries whatever the state is when it closes.
+      // a steady stream of changes still gets a write out every few windows
+      uint32_t now = millis();
+      if (!this->write_debouncing_)
+        this->write_debounce_start_ = now;
+      this->write_debouncing_ = true;
+
+      uint32_t held = now - this->write_debounce_start_;
+      uint32_t limit = this->write_debounce_ * LGAP_WRITE_DEBOUNCE_MAX_WINDOWS;
+      uint32_t delay = held >= limit ? 0 : std::min(this->write_debounce_, limit - held);
+      this->set_timeout("write_debounce", delay, [this]() {
+        this->write_debouncing_ = false;
+        if (this->parent_ != nullptr && this->write_update_pending)
+          this->parent_->queue_write(this);
+      });
+    }
+
+    void LGAPDevice::generate_lgap_request(LGAPRequest &message, uint8_t request_id)
     {
       this->handle_generate_lgap_request(message, request_id);
+      if (message.is_write())
+      {
+        this->decode_next_ = true;
+        this->written_ = message;
+        this->write_unconfirmed_ = true;
+        this->write_answered_ = false;
+        this->readback_due_ = false;
+        this->write_attempts_++;
+      }
+    }
+
+    void LGAPDevice::verify_write(const LGAPResponse &message)
+    {
+      if (message.confirms(this->written_))
+      {
+        uint32_t latency = millis() - this->write_command_time_;
+        ESP_LOGD(TAG, "Zone %d confirmed the write after %" PRIu32 "ms (%d attempts)", this->zone_number, latency, this->write_attempts_);
+        if (this->write_ack_latency_sensor_ != nullptr)
+          this->write_ack_latency_sensor_->publish_state(latency);
+        this->write_unconfirmed_ = false;
+        this->readback_due_ = false;
+        this->decode_next_ = true;
+        return;
+      }
+
+      if (!this->write_answered_)
+      {
+        this->write_answered_ = true;
+        this->readback_due_ = true;
+        return;
+      }
+
+      this->readback_due_ = false;
+      this->retry_write();
+    }
+
+    void LGAPDevice::retry_write()
+    {
+      if (this->write_attempts_ > this->write_retries_)
+      {
+        // the unit's own state wins from here on
+        ESP_LOGW(TAG, "Zone %d did not take the write after %d attempts, giving up", this->zone_number, this->write_attempts_);
+        this->write_unconfirmed_ = false;
+        this->write_failed_ = true;
+        this->write_failures_++;
+        this->decode_next_ = true;
+        this->write_failed_callback_.call();
+        return;
+      }
+
+      // straight back in the queue, the target state was settled before the first attempt
+      ESP_LOGD(TAG, "Zone %d did not echo the write, sending it again", this->zone_number);
+      this->write_update_pending = true;
+      if (this->parent_ != nullptr)
+        this->parent_->queue_write(this);
     }
 
 
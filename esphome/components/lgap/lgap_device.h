@@ -1,7 +1,12 @@
 #pragma once
-#include <vector>
 #include <stdint.h>
 #include "lgap.h"
+#include "lgap_bulk.h"
+#include "lgap_frame.h"
+#include "lgap_stats.h"
+#include "esphome/components/sensor/sensor.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/core/helpers.h"
 
 namespace esphome
 {
@@ -9,6 +14,9 @@ namespace esphome
   {
     class LGAP;
 
+    // longest a write is held back by a stream of changes, in debounce windows
+    static const uint8_t LGAP_WRITE_DEBOUNCE_MAX_WINDOWS = 4;
+
     class LGAPDevice : public Component
     {
       public:
@@ -18,20 +26,125 @@ namespace esphome
         void set_parent(LGAP *parent) { parent_ = parent; }
         void set_zone_number(int zone_number) { this->zone_number = zone_number; }
 
-        void on_message_received(std::vector<uint8_t> &message);
-        void generate_lgap_request(std::vector<uint8_t> &message, uint8_t &request_id);
+        // freshness targets used by the poll scheduler, 0 polls as often as the bus allows
+        void set_max_staleness_off(uint32_t time_in_ms) { this->max_staleness_off_ = time_in_ms; }
+        void set_max_staleness_running(uint32_t time_in_ms) { this->max_staleness_running_ = time_in_ms; }
+        void set_fast_poll_interval(uint32_t time_in_ms) { this->fast_poll_interval_ = time_in_ms; }
+        void set_fast_poll_duration(uint32_t time_in_ms) { this->fast_poll_duration_ = time_in_ms; }
+        uint32_t get_poll_interval() const;
+        // republish everything even when nothing changed, 0 disables
+        void set_heartbeat_interval(uint32_t time_in_ms) { this->heartbeat_interval_ = time_in_ms; }
+
+        // mark the device dirty and queue it ahead of the status polling once write_debounce has passed
+        // without another change, so a burst of changes goes out as one write of the merged state
+        void request_write(bool debounce = true);
+        void set_write_debounce(uint32_t time_in_ms) { this->write_debounce_ = time_in_ms; }
+        // a write is pending and its debounce window has passed
+        bool write_ready() const { return this->write_update_pending && !this->write_debouncing_; }
+        // queued, or sent and not yet echoed back by the unit, frames from the unit don't override the target state meanwhile
+        bool write_pending() const { return this->write_update_pending || this->write_unconfirmed_; }
+        // writes the unit doesn't echo back are sent again up to this many times before giving up
+        void set_write_retries(uint8_t retries) { this->write_retries_ = retries; }
+        void set_write_ack_latency_sensor(sensor::Sensor *sensor) { this->write_ack_latency_sensor_ = sensor; }
+        void add_on_write_failed_callback(std::function<void()> &&callback) { this->write_failed_callback_.add(std::move(callback)); }
+
+        void set_poll_interval_sensor(sensor::Sensor *sensor) { this->poll_interval_sensor_ = sensor; }
+        void set_timeouts_sensor(sensor::Sensor *sensor) { this->timeouts_sensor_ = sensor; }
+        void set_available_sensor(binary_sensor::BinarySensor *sensor) { this->available_sensor_ = sensor; }
+        bool is_available() const { return this->available_; }
+        // true while LGAP is holding off polls after failed transactions
+        bool in_backoff() const;
+        void publish_stats();
+        void dump_stats();
+
+        void on_message_received(const LGAPResponse &message);
+        void generate_lgap_request(LGAPRequest &message, uint8_t request_id);
         
         // uint32_t last_uart_update_time_{0};
         // uint32_t last_ha_update_time_{0};
 
       protected:
         friend LGAP;
-        LGAP *parent_;
+        LGAP *parent_{nullptr};
 
         int zone_number{-1};
 
-        virtual void handle_on_message_received(std::vector<uint8_t> &message) = 0;
-        virtual void handle_generate_lgap_request(std::vector<uint8_t> &message, uint8_t &request_id) = 0;
+        uint32_t max_staleness_off_{0};
+        uint32_t max_staleness_running_{0};
+        uint32_t fast_poll_interval_{1000};
+        uint32_t fast_poll_duration_{10000};
+        uint32_t fast_poll_until_{0};
+        uint32_t last_request_time_{0};
+        // set by LGAP while a request for this zone is waiting for its answer
+        bool in_flight_{false};
+        // polls during the debounce window stay reads, the write goes out once the window closes
+        uint32_t write_debounce_{200};
+        bool write_debouncing_{false};
+        uint32_t write_debounce_start_{0};
+
+        // write acknowledgement, the last write sent is kept until a frame from the unit echoes it. the answer to the
+        // write itself can still carry the old state, so a mismatch there only asks LGAP for an immediate read-back,
+        // and a mismatch on the read-back sends the write again
+        LGAPRequest written_;
+        bool write_unconfirmed_{false};
+        bool write_answered_{false};
+        bool readback_due_{false};
+        uint8_t write_attempts_{0};
+        uint8_t write_retries_{2};
+        uint32_t write_command_time_{0};
+        uint32_t write_failures_{0};
+        sensor::Sensor *write_ack_latency_sensor_{nullptr};
+        CallbackManager<void()> write_failed_callback_;
+        void verify_write(const LGAPResponse &message);
+        void retry_write();
+        // the last write was given up on
+        bool write_failed_{false};
+
+        // set by LGAP while this zone is part of a bulk command
+        bool bulk_pending_{false};
+        // merge a bulk command into the target state and request an immediate write if it changed
+        virtual LGAPBulkResult apply_bulk(const LGAPBulkTarget &target) { return BULK_BLOCKED; }
+
+        // bus health for this zone, maintained by LGAP
+        LGAPCounters counters_;
+        uint32_t last_response_time_{0};
+        float poll_interval_avg_{NAN};
+        sensor::Sensor *poll_interval_sensor_{nullptr};
+        sensor::Sensor *timeouts_sensor_{nullptr};
+
+        // zone health, maintained by LGAP. available_ starts unknown and is published on the first verdict
+        uint8_t consecutive_failures_{0};
+        // boot sweep, swept_ once the first sweep poll has gone out. its miss is held back in sweep_missed_ until the
+        // next poll, so a zone slow to answer its first request after boot isn't counted down for it
+        bool swept_{false};
+        bool sweep_missed_{false};
+        uint32_t backoff_until_{0};
+        bool available_{false};
+        bool available_known_{false};
+        binary_sensor::BinarySensor *available_sensor_{nullptr};
+        void set_available(bool available);
+
+        // trailing-edge publishing, the device keeps the newest held back value and LGAP flushes it
+        // at publish_due_, batched with any other zone due around the same time
+        bool publish_pending_{false};
+        uint32_t publish_due_{0};
+        void schedule_publish(uint32_t due);
+        void cancel_publish() { this->publish_pending_ = false; }
+        virtual void flush_pending_publish() {}
+
+        // last frame received, used to spot state changes reported by the unit and to skip decoding unchanged frames
+        LGAPResponse last_response_;
+        bool has_response_{false};
+        // set once a write goes out, the unit may not have taken it so the next frame is always decoded
+        bool decode_next_{false};
+        uint32_t heartbeat_interval_{600000};
+        uint32_t last_heartbeat_time_{0};
+
+        virtual bool is_running() const = 0;
+
+        // republish is set on the first frame and on every heartbeat, everything should be published regardless of deadbands
+        virtual void handle_on_message_received(const LGAPResponse &message, bool republish) = 0;
+        virtual void handle_generate_lgap_request(LGAPRequest &message, uint8_t request_id) = 0;
     };
 
   } // namespace lgap
@@ -0,0 +1,230 @@
+#include "lgap.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cinttypes>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    void LGAP::set_discovery_key(const std::string &key)
+    {
+      // one map per bus, keyed on the component id
+      this->discovery_key_ = fnv1_hash("lgap_zone_map_" + key);
+    }
+
+    void LGAP::setup_discovery()
+    {
+      if (this->discovery_state_ == DISCOVERY_DISABLED)
+        return;
+
+      if (this->probe_headers_.empty())
+        this->probe_headers_.push_back(this->tx_byte_0_);
+
+      // the map only changes when zones are added or removed, so it lives in flash
+      this->zone_map_pref_ = global_preferences->make_preference<LGAPZoneMap>(this->discovery_key_, true);
+
+      LGAPZoneMap stored;
+      bool loaded = !this->force_scan_ && this->zone_map_pref_.load(&stored) && stored.version == LGAP_ZONE_MAP_VERSION && stored.count > 0;
+
+      // a map found with a header that's no longer in the probe list is stale
+      bool header_known = false;
+      for (auto header : this->probe_headers_)
+        header_known |= loaded && header == stored.header;
+
+      if (loaded && header_known)
+      {
+        ESP_LOGI(TAG, "Loaded zone map with %d zones (header 0x%02X), skipping scan", stored.count, stored.header);
+        this->zone_map_ = stored;
+        this->tx_byte_0_ = stored.header;
+        this->discovery_state_ = DISCOVERY_CACHED;
+        this->last_reprobe_time_ = millis();
+        if (this->discovered_zones_sensor_ != nullptr)
+          this->discovered_zones_sensor_->publish_state(this->zone_map_.count);
+        return;
+      }
+
+      ESP_LOGI(TAG, "No usable zone map stored, scanning zones 0-255");
+      this->discovery_state_ = DISCOVERY_SCANNING;
+      this->scan_start_time_ = millis();
+    }
+
+    void LGAP::dump_discovery()
+    {
+      if (this->discovery_state_ == DISCOVERY_DISABLED)
+        return;
+
+      ESP_LOGCONFIG(TAG, "  Discovery: %s", this->discovery_state_ == DISCOVERY_SCANNING ? "scanning" : "cached");
+      if (this->probe_timeout_ > 0)
+        ESP_LOGCONFIG(TAG, "    Probe timeout: %dms", this->probe_timeout_);
+      else
+        ESP_LOGCONFIG(TAG, "    Probe timeout: same as polls");
+      ESP_LOGCONFIG(TAG, "    Reprobe interval: %" PRIu32 "ms", this->reprobe_interval_);
+      for (auto header : this->probe_headers_)
+        ESP_LOGCONFIG(TAG, "    Probe header: 0x%02X", header);
+      LOG_SENSOR("    ", "Discovered Zones", this->discovered_zones_sensor_);
+
+      for (uint8_t i = 0; i < this->zone_map_.count; i++)
+      {
+        const LGAPDiscoveredZone &zone = this->zone_map_.zones[i];
+        ESP_LOGCONFIG(TAG, "    Zone %d: IDU %s, design load %d", zone.zone, zone.connected() ? "connected" : "disconnected", zone.design_load);
+      }
+    }
+
+    bool LGAP::next_probe(uint8_t &zone, uint8_t &header)
+    {
+      switch (this->discovery_state_)
+      {
+        case DISCOVERY_SCANNING:
+          zone = this->scan_address_;
+          header = this->probe_headers_[this->probe_header_index_];
+          return true;
+
+        case DISCOVERY_CACHED:
+          // one address per interval keeps the background probing well clear of the regular polls
+          if (this->reprobe_interval_ == 0 || (millis() - this->last_reprobe_time_) < this->reprobe_interval_)
+            return false;
+          this->last_reprobe_time_ = millis();
+          zone = this->reprobe_address_;
+          header = this->zone_map_.header;
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    bool LGAP::send_probe(uint32_t timeout)
+    {
+      uint8_t zone, header;
+      if (this->probing_ || !this->next_probe(zone, header))
+        return false;
+
+      ESP_LOGV(TAG, "Probing zone %d with header 0x%02X", zone, header);
+
+      // a plain read with every control field cleared
+      this->tx_frame_ = LGAPRequest{};
+      this->tx_frame_.set_header(header);
+      this->tx_frame_.set_request_id(this->next_request_id());
+      this->tx_frame_.set_zone(zone);
+      this->tx_frame_.seal();
+      // a probe gets as long as a poll, a zone that is slow to answer is still a zone
+      this->start_transaction(nullptr, this->probe_timeout_ > 0 ? this->probe_timeout_ : timeout);
+      this->probed_since_poll_ = true;
+      return true;
+    }
+
+    void LGAP::handle_probe_result(uint8_t zone, const LGAPResponse *frame)
+    {
+      if (this->discovery_state_ == DISCOVERY_SCANNING)
+      {
+        if (frame != nullptr)
+        {
+          ESP_LOGI(TAG, "Discovered zone %d (IDU %s, design load %d)", zone, frame->idu_connected() ? "connected" : "disconnected", frame->zone_design_load());
+          this->zone_map_.update(zone, frame->idu_connected(), frame->zone_design_load());
+        }
+
+        if (this->scan_address_ < 255)
+        {
+          this->scan_address_++;
+          return;
+        }
+
+        // nothing answered this header, sweep again with the next one
+        if (this->zone_map_.count == 0 && this->probe_header_index_ + 1u < this->probe_headers_.size())
+        {
+          this->probe_header_index_++;
+          this->scan_address_ = 0;
+          ESP_LOGI(TAG, "No zones answered header 0x%02X, scanning with 0x%02X", this->probe_headers_[this->probe_header_index_ - 1], this->probe_headers_[this->probe_header_index_]);
+          return;
+        }
+
+        this->finish_scan();
+        return;
+      }
+
+      bool changed = false;
+      if (frame != nullptr)
+      {
+        this->reprobe_retry_ = false;
+        changed = this->zone_map_.update(zone, frame->idu_connected(), frame->zone_design_load());
+        if (changed)
+          ESP_LOGI(TAG, "Zone %d updated (IDU %s, design load %d)", zone, frame->idu_connected() ? "connected" : "disconnected", frame->zone_design_load());
+      }
+      else if (this->zone_map_.find(zone) != nullptr && !this->reprobe_retry_)
+      {
+        // give a known zone a second chance before dropping it, a single lost frame shouldn't rewrite the map
+        this->reprobe_retry_ = true;
+        return;
+      }
+      else
+      {
+        this->reprobe_retry_ = false;
+        changed = this->zone_map_.remove(zone);
+        if (changed)
+        {
+          ESP_LOGW(TAG, "Zone %d no longer answers, removed from zone map", zone);
+          this->odu_.remove(zone);
+        }
+      }
+
+      // wraps back to 0 after 255
+      this->reprobe_address_++;
+
+      if (changed)
+        this->save_zone_map();
+    }
+
+    void LGAP::handle_late_probe(uint8_t zone, const LGAPResponse &frame)
+    {
+      // the scan has already moved on, but the zone is real
+      if (this->discovery_state_ == DISCOVERY_DISABLED || !this->zone_map_.update(zone, frame.idu_connected(), frame.zone_design_load()))
+        return;
+
+      ESP_LOGI(TAG, "Discovered zone %d from a late answer (IDU %s, design load %d)", zone, frame.idu_connected() ? "connected" : "disconnected", frame.zone_design_load());
+      if (this->discovery_state_ == DISCOVERY_CACHED)
+        this->save_zone_map();
+    }
+
+    void LGAP::finish_scan()
+    {
+      ESP_LOGI(TAG, "Zone scan finished in %" PRIu32 "s, %d zones answered", (millis() - this->scan_start_time_) / 1000, this->zone_map_.count);
+
+      this->discovery_state_ = DISCOVERY_CACHED;
+      this->last_reprobe_time_ = millis();
+      this->reprobe_address_ = 0;
+      this->zone_map_.version = LGAP_ZONE_MAP_VERSION;
+
+      if (this->zone_map_.count == 0)
+      {
+        // nothing is saved, so the next boot scans again
+        ESP_LOGW(TAG, "No zones answered the scan, check wiring and tx_byte_0");
+        this->zone_map_.header = this->tx_byte_0_;
+      }
+      else
+      {
+        this->zone_map_.header = this->probe_headers_[this->probe_header_index_];
+        if (this->zone_map_.header != this->tx_byte_0_)
+          ESP_LOGI(TAG, "Zones answered header 0x%02X, using it instead of 0x%02X", this->zone_map_.header, this->tx_byte_0_);
+        this->tx_byte_0_ = this->zone_map_.header;
+        this->save_zone_map();
+      }
+
+      for (auto *device : this->devices_)
+      {
+        if (device->zone_number > -1 && this->zone_map_.find(device->zone_number) == nullptr)
+          ESP_LOGW(TAG, "Zone %d is configured but did not answer the scan", device->zone_number);
+      }
+    }
+
+    void LGAP::save_zone_map()
+    {
+      if (!this->zone_map_pref_.save(&this->zone_map_))
+        ESP_LOGW(TAG, "Failed to save zone map");
+
+      if (this->discovered_zones_sensor_ != nullptr)
+        this->discovered_zones_sensor_->publish_state(this->zone_map_.count);
+    }
+
+  } // namespace lgap
+} // namespace esphome
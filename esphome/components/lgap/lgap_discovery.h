@@ -0,0 +1,99 @@
+#pragma once
+#include <stdint.h>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // bump whenever the layout of LGAPZoneMap changes so a stale map is rescanned instead of misread
+    static const uint8_t LGAP_ZONE_MAP_VERSION = 1;
+    static const uint8_t LGAP_ZONE_MAP_MAX_ZONES = 64;
+
+    // flags kept for every discovered zone
+    static const uint8_t LGAP_ZONE_FLAG_CONNECTED = 0x01;
+
+    enum DiscoveryState
+    {
+      DISCOVERY_DISABLED,
+      // sweeping every address, at boot when there is no stored map
+      DISCOVERY_SCANNING,
+      // map loaded or scan finished, addresses are re-probed one at a time in the background
+      DISCOVERY_CACHED
+    };
+
+    struct LGAPDiscoveredZone
+    {
+      uint8_t zone;
+      uint8_t flags;
+      uint8_t design_load;
+
+      bool connected() const { return (this->flags & LGAP_ZONE_FLAG_CONNECTED) != 0; }
+    };
+
+    // zones that answered a probe, stored as-is in preferences so it must stay trivially copyable
+    struct LGAPZoneMap
+    {
+      uint8_t version{0};
+      // tx_byte_0 the zones answered to
+      uint8_t header{0};
+      uint8_t count{0};
+      LGAPDiscoveredZone zones[LGAP_ZONE_MAP_MAX_ZONES]{};
+
+      const LGAPDiscoveredZone *find(uint8_t zone) const
+      {
+        for (uint8_t i = 0; i < this->count; i++)
+        {
+          if (this->zones[i].zone == zone)
+            return &this->zones[i];
+        }
+        return nullptr;
+      }
+
+      // add or refresh a zone, returns true if the map changed
+      bool update(uint8_t zone, bool connected, uint8_t design_load)
+      {
+        uint8_t flags = connected ? LGAP_ZONE_FLAG_CONNECTED : 0;
+        for (uint8_t i = 0; i < this->count; i++)
+        {
+          if (this->zones[i].zone != zone)
+            continue;
+          if (this->zones[i].flags == flags && this->zones[i].design_load == design_load)
+            return false;
+          this->zones[i].flags = flags;
+          this->zones[i].design_load = design_load;
+          return true;
+        }
+
+        if (this->count >= LGAP_ZONE_MAP_MAX_ZONES)
+          return false;
+
+        // keep the map sorted by zone so it reads naturally in the logs
+        uint8_t i = this->count;
+        while (i > 0 && this->zones[i - 1].zone > zone)
+        {
+          this->zones[i] = this->zones[i - 1];
+          i--;
+        }
+        this->zones[i] = {zone, flags, design_load};
+        this->count++;
+        return true;
+      }
+
+      // returns true if the zone was in the map
+      bool remove(uint8_t zone)
+      {
+        for (uint8_t i = 0; i < this->count; i++)
+        {
+          if (this->zones[i].zone != zone)
+            continue;
+          for (uint8_t j = i + 1; j < this->count; j++)
+            this->zones[j - 1] = this->zones[j];
+          this->count--;
+          return true;
+        }
+        return false;
+      }
+    };
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,89 @@
+#pragma once
+#include <cmath>
+#include <stdint.h>
+#include "lgap_frame.h"
+#include "esphome/components/sensor/sensor.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    enum LGAPFieldFormula : uint8_t
+    {
+      // raw * scale + offset
+      FIELD_LINEAR,
+      // the LG temperature curve (192 - raw) / 3 in °C, then scale and offset
+      FIELD_LG_TEMPERATURE,
+      // raw taken as two's complement over the width of the mask, then scale and offset
+      FIELD_SIGNED
+    };
+
+    // one value in a response frame: (frame[byte] & mask) >> shift, then the formula
+    struct LGAPField
+    {
+      uint8_t byte;
+      uint8_t mask;
+      uint8_t shift;
+      float scale;
+      float offset;
+      LGAPFieldFormula formula;
+
+      constexpr float apply(uint8_t value) const
+      {
+        uint8_t raw = (value & this->mask) >> this->shift;
+        switch (this->formula)
+        {
+          case FIELD_LG_TEMPERATURE:
+            return (192 - raw) / 3.0f * this->scale + this->offset;
+          case FIELD_SIGNED:
+          {
+            uint8_t max = this->mask >> this->shift;
+            int signed_value = raw > max / 2 ? raw - max - 1 : raw;
+            return signed_value * this->scale + this->offset;
+          }
+          case FIELD_LINEAR:
+          default:
+            return raw * this->scale + this->offset;
+        }
+      }
+
+      float decode(const LGAPResponse &frame) const { return this->apply(frame[this->byte]); }
+    };
+
+    // RX5: 0 is OK, anything else is a service code
+    static constexpr LGAPField LGAP_FIELD_ERROR_CODE{5, 0xFF, 0, 1.0f, 0.0f, FIELD_LINEAR};
+    // RX9 and RX10: refrigerant pipe temperatures, same curve as the room temperature
+    static constexpr LGAPField LGAP_FIELD_PIPE_IN{9, 0xFF, 0, 1.0f, 0.0f, FIELD_LG_TEMPERATURE};
+    static constexpr LGAPField LGAP_FIELD_PIPE_OUT{10, 0xFF, 0, 1.0f, 0.0f, FIELD_LG_TEMPERATURE};
+    // RX11: LonWorks nvoLoadEstimate, ~204 idle and lower under load
+    static constexpr LGAPField LGAP_FIELD_ZONE_ACTIVE_LOAD{11, 0xFF, 0, 1.0f, 0.0f, FIELD_LINEAR};
+    // RX12: LonWorks nvoOnOff, 0 running and 1 off, jitters during transitions
+    static constexpr LGAPField LGAP_FIELD_ZONE_POWER_STATE{12, 0xFF, 0, 1.0f, 0.0f, FIELD_LINEAR};
+    // RX13: LonWorks nciRatedCapacity, a fixed design weight such as 9, 12 or 24
+    static constexpr LGAPField LGAP_FIELD_ZONE_DESIGN_LOAD{13, 0xFF, 0, 1.0f, 0.0f, FIELD_LINEAR};
+
+    // a field published to a sensor once it moves by more than deadband
+    struct LGAPFieldSensor
+    {
+      LGAPField field;
+      sensor::Sensor *sensor;
+      float deadband;
+    };
+
+    // publish only when the value moved by more than the deadband, or when forced by a heartbeat
+    inline void publish_sensor(sensor::Sensor *sensor, float value, float deadband, bool force)
+    {
+      if (sensor == nullptr || std::isnan(value))
+        return;
+
+      if (!force && sensor->has_state())
+      {
+        float delta = std::fabs(value - sensor->get_raw_state());
+        if (delta == 0.0f || delta < deadband)
+          return;
+      }
+      sensor->publish_state(value);
+    }
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,181 @@
+#pragma once
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    static const uint8_t LGAP_REQUEST_LENGTH = 8;
+    static const uint8_t LGAP_RESPONSE_LENGTH = 16;
+    static const uint8_t LGAP_RESPONSE_HEADER = 0x10;
+    // the ODU ignores requests with a TX2 request id below this, see ref/lgap-req-2.csv
+    static const uint8_t LGAP_REQUEST_ID_MIN = 0xA0;
+
+    // the checksum method is the same as the LG wall controller
+    // borrowed this checksum function from:
+    // https://github.com/JanM321/esphome-lg-controller/blob/998b78a212f798267feca0a91475726516228b56/esphome/lg-controller.h#L631C1-L637C6
+    // the last byte of the frame is the checksum itself and is not summed
+    constexpr uint8_t calculate_checksum(const uint8_t *data, size_t length)
+    {
+      size_t result = 0;
+      for (size_t i = 0; i + 1 < length; i++)
+      {
+        result += data[i];
+      }
+      return (result & 0xff) ^ 0x55;
+    }
+
+    // 8 byte request (TX0-TX7), see protocol.md for the field layout
+    struct LGAPRequest
+    {
+      std::array<uint8_t, LGAP_REQUEST_LENGTH> data{};
+
+      uint8_t header() const { return this->data[0]; }
+      uint8_t command_type() const { return this->data[1]; }
+      uint8_t request_id() const { return this->data[2]; }
+      uint8_t zone() const { return this->data[3]; }
+      uint8_t control_flags() const { return this->data[4]; }
+      uint8_t mode_fan() const { return this->data[5]; }
+      uint8_t target_temperature_raw() const { return this->data[6]; }
+      uint8_t checksum() const { return this->data[7]; }
+
+      void set_header(uint8_t value) { this->data[0] = value; }
+      void set_command_type(uint8_t value) { this->data[1] = value; }
+      void set_request_id(uint8_t value) { this->data[2] = value; }
+      void set_zone(uint8_t value) { this->data[3] = value; }
+      void set_control_flags(uint8_t value) { this->data[4] = value; }
+      void set_mode_fan(uint8_t value) { this->data[5] = value; }
+      void set_target_temperature_raw(uint8_t value) { this->data[6] = value; }
+
+      bool is_write() const { return (this->data[4] & 0x02) != 0; }
+
+      // calculate and store the checksum, must be called after the last field is set
+      void seal() { this->data[7] = calculate_checksum(this->data.data(), this->data.size()); }
+
+      const uint8_t *bytes() const { return this->data.data(); }
+      static constexpr size_t size() { return LGAP_REQUEST_LENGTH; }
+    };
+
+    // 16 byte response (RX0-RX15), see protocol.md for the field layout
+    struct LGAPResponse
+    {
+      std::array<uint8_t, LGAP_RESPONSE_LENGTH> data{};
+
+      uint8_t operator[](size_t index) const { return this->data[index]; }
+      bool operator==(const LGAPResponse &other) const { return this->data == other.data; }
+      bool operator!=(const LGAPResponse &other) const { return this->data != other.data; }
+
+      uint8_t header() const { return this->data[0]; }
+      uint8_t flags() const { return this->data[1]; }
+      uint8_t request_id() const { return this->data[2]; }
+      uint8_t unknown_3() const { return this->data[3]; }
+      uint8_t zone() const { return this->data[4]; }
+      uint8_t error_code() const { return this->data[5]; }
+      uint8_t mode_fan() const { return this->data[6]; }
+      uint8_t target_temperature_raw() const { return this->data[7]; }
+      uint8_t room_temperature_raw() const { return this->data[8]; }
+      uint8_t pipe_in_raw() const { return this->data[9]; }
+      uint8_t pipe_out_raw() const { return this->data[10]; }
+      uint8_t zone_active_load() const { return this->data[11]; }
+      uint8_t zone_power_state() const { return this->data[12]; }
+      uint8_t zone_design_load() const { return this->data[13]; }
+      uint8_t odu_total_load() const { return this->data[14]; }
+      uint8_t checksum() const { return this->data[15]; }
+
+      // RX1 flags
+      uint8_t power_state() const { return this->data[1] & 0x01; }
+      bool idu_connected() const { return (this->data[1] & 0x02) != 0; }
+      bool control_lock() const { return (this->data[1] & 0x04) != 0; }
+      bool plasma() const { return (this->data[1] & 0x10) != 0; }
+
+      // RX6 mode / swing / fan
+      uint8_t mode() const { return this->data[6] & 0x07; }
+      uint8_t swing() const { return (this->data[6] >> 3) & 0x01; }
+      uint8_t fan_speed() const { return (this->data[6] >> 4) & 0x07; }
+
+      // same unit state, ignoring the request id echo and the checksum that depends on it
+      bool same_state(const LGAPResponse &other) const
+      {
+        for (size_t i = 0; i < LGAP_RESPONSE_LENGTH - 1; i++)
+        {
+          if (i != 2 && this->data[i] != other.data[i])
+            return false;
+        }
+        return true;
+      }
+
+      // the unit has taken a write, RX1/RX6/RX7 echo what TX4/TX5/TX6 asked for
+      bool confirms(const LGAPRequest &request) const
+      {
+        uint8_t power = request.control_flags() & 0x01;
+        if (this->power_state() != power)
+          return false;
+        // switching off is all an off write asks for
+        if (power == 0)
+          return true;
+        // fan speed 0 is NO_CHANGE, the unit keeps whatever it had
+        uint8_t mask = (request.mode_fan() & 0x70) == 0 ? 0x0F : 0x7F;
+        return (this->mode_fan() & mask) == (request.mode_fan() & mask) &&
+               (this->target_temperature_raw() & 0x0F) == (request.target_temperature_raw() & 0x0F);
+      }
+
+      bool checksum_valid() const { return calculate_checksum(this->data.data(), this->data.size()) == this->data[15]; }
+
+      const uint8_t *bytes() const { return this->data.data(); }
+      static constexpr size_t size() { return LGAP_RESPONSE_LENGTH; }
+    };
+
+    enum ReceiveResult
+    {
+      RECEIVE_NEED_MORE,
+      RECEIVE_FRAME_COMPLETE,
+      RECEIVE_BAD_HEADER,
+      RECEIVE_BAD_CHECKSUM
+    };
+
+    // assembles a response frame from a byte stream, keeping a running checksum so the
+    // frame is validated as soon as its last byte is pushed. has no esphome dependencies
+    // so the framing can be built and exercised on its own.
+    class LGAPFrameReceiver
+    {
+      public:
+        ReceiveResult push(uint8_t c)
+        {
+          if (this->length_ == 0 && c != LGAP_RESPONSE_HEADER)
+            return RECEIVE_BAD_HEADER;
+
+          this->frame_.data[this->length_++] = c;
+
+          // the checksum covers everything but the last byte
+          if (this->length_ < LGAP_RESPONSE_LENGTH)
+          {
+            this->checksum_ += c;
+            return RECEIVE_NEED_MORE;
+          }
+
+          return ((this->checksum_ & 0xff) ^ 0x55) == c ? RECEIVE_FRAME_COMPLETE : RECEIVE_BAD_CHECKSUM;
+        }
+
+        void reset()
+        {
+          this->length_ = 0;
+          this->checksum_ = 0;
+        }
+
+        uint8_t length() const { return this->length_; }
+        size_t remaining() const { return LGAP_RESPONSE_LENGTH - this->length_; }
+        // a frame that stops part way through is never going to complete, a whole frame's time without a byte
+        // gives up on it
+        bool stalled(uint32_t idle_ms, uint32_t byte_time_us) const { return this->length_ > 0 && idle_ms > LGAP_RESPONSE_LENGTH * byte_time_us / 1000; }
+        const LGAPResponse &frame() const { return this->frame_; }
+
+      protected:
+        LGAPResponse frame_;
+        uint8_t length_{0};
+        uint16_t checksum_{0};
+    };
+
+  } // namespace lgap
+} // namespace esphome
\ No newline at end of file
@@ -0,0 +1,125 @@
+#include "lgap_odu.h"
+#include "esphome/core/log.h"
+#include <cmath>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    static const char *const TAG = "lgap.odu";
+
+    float LGAPOdu::get_load_percent() const
+    {
+      if (this->design_load_total_ == 0)
+        return NAN;
+      return this->total_load_ * 100.0f / this->design_load_total_;
+    }
+
+    LGAPOduZone *LGAPOdu::find(uint8_t zone)
+    {
+      for (uint8_t i = 0; i < this->count_; i++)
+      {
+        if (this->zones_[i].zone == zone)
+          return &this->zones_[i];
+      }
+      return nullptr;
+    }
+
+    bool LGAPOdu::drop(uint8_t zone)
+    {
+      LGAPOduZone *entry = this->find(zone);
+      if (entry == nullptr)
+        return false;
+
+      // order doesn't matter here, the last entry fills the gap
+      *entry = this->zones_[--this->count_];
+      return true;
+    }
+
+    void LGAPOdu::ingest(const LGAPResponse &frame)
+    {
+      // RX14: ODU Total Load Index (LonWorks: nvoThermalLoad / nvoOduLoadFactor)
+      // - Same value reported to all IDUs connected to the same ODU
+      // - Approximately sum of design indices (RX13) of all ON zones, smoothed
+      // - Max load = sum of rated loads of connected zones, goes to 0 when all zones are off
+      bool force = !this->has_frame_;
+      bool changed = force || frame.odu_total_load() != this->total_load_;
+      this->total_load_ = frame.odu_total_load();
+      this->has_frame_ = true;
+
+      // RX12 is 0 while the zone is running
+      bool active = frame.zone_power_state() == 0;
+      LGAPOduZone *entry = this->find(frame.zone());
+      if (!frame.idu_connected())
+      {
+        // a disconnected IDU can't draw on the ODU, so it's left out of the design load total
+        changed |= this->drop(frame.zone());
+      }
+      else if (entry == nullptr && this->count_ >= LGAP_ODU_MAX_ZONES)
+      {
+        ESP_LOGW(TAG, "Too many zones, zone %d is left out of the ODU totals", frame.zone());
+      }
+      else if (entry == nullptr || entry->design_load != frame.zone_design_load() || entry->active != active)
+      {
+        if (entry == nullptr)
+          entry = &this->zones_[this->count_++];
+        entry->zone = frame.zone();
+        entry->design_load = frame.zone_design_load();
+        entry->active = active;
+        changed = true;
+      }
+
+      if (!changed)
+        return;
+
+      this->update_totals();
+      this->publish(force);
+    }
+
+    void LGAPOdu::remove(uint8_t zone)
+    {
+      if (!this->drop(zone))
+        return;
+
+      this->update_totals();
+      this->publish(false);
+    }
+
+    void LGAPOdu::update_totals()
+    {
+      this->design_load_total_ = 0;
+      this->active_zones_ = 0;
+      for (uint8_t i = 0; i < this->count_; i++)
+      {
+        this->design_load_total_ += this->zones_[i].design_load;
+        if (this->zones_[i].active)
+          this->active_zones_++;
+      }
+    }
+
+    void LGAPOdu::publish(bool force)
+    {
+      ESP_LOGD(TAG, "ODU load %d of %d (%.0f%%), %d active zones", this->total_load_, this->design_load_total_, this->get_load_percent(), this->active_zones_);
+
+      publish_sensor(this->total_load_sensor_, this->total_load_, this->load_deadband_, force);
+      publish_sensor(this->design_load_total_sensor_, this->design_load_total_, 0.0f, force);
+      publish_sensor(this->active_zones_sensor_, this->active_zones_, 0.0f, force);
+
+      // the deadband is in load counts, scale it to the percentage
+      float percent_deadband = this->design_load_total_ > 0 ? this->load_deadband_ * 100.0f / this->design_load_total_ : 0.0f;
+      publish_sensor(this->load_percent_sensor_, this->get_load_percent(), percent_deadband, force);
+    }
+
+    void LGAPOdu::dump_config()
+    {
+      ESP_LOGCONFIG(TAG, "  ODU:");
+      ESP_LOGCONFIG(TAG, "    Load deadband: %.1f", this->load_deadband_);
+      ESP_LOGCONFIG(TAG, "    Load %d of %d from %d zones, %d active", this->total_load_, this->design_load_total_, this->count_, this->active_zones_);
+      LOG_SENSOR("    ", "Total Load", this->total_load_sensor_);
+      LOG_SENSOR("    ", "Load Percent", this->load_percent_sensor_);
+      LOG_SENSOR("    ", "Design Load Total", this->design_load_total_sensor_);
+      LOG_SENSOR("    ", "Active Zones", this->active_zones_sensor_);
+    }
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <stdint.h>
+#include "lgap_fields.h"
+#include "lgap_frame.h"
+#include "esphome/components/sensor/sensor.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // same limit as the zone map, a single ODU drives far fewer IDUs than that
+    static const uint8_t LGAP_ODU_MAX_ZONES = 64;
+
+    // what the ODU has reported about one zone, kept so the design loads can be summed
+    struct LGAPOduZone
+    {
+      uint8_t zone{0};
+      uint8_t design_load{0};
+      bool active{false};
+    };
+
+    // RX14 is the same in every frame from an ODU, so it's tracked once per bus here rather than per zone.
+    // every valid frame is ingested, including probes and late answers, and the sensors only publish on change
+    class LGAPOdu
+    {
+      public:
+        void set_total_load_sensor(sensor::Sensor *sensor) { this->total_load_sensor_ = sensor; }
+        void set_load_percent_sensor(sensor::Sensor *sensor) { this->load_percent_sensor_ = sensor; }
+        void set_design_load_total_sensor(sensor::Sensor *sensor) { this->design_load_total_sensor_ = sensor; }
+        void set_active_zones_sensor(sensor::Sensor *sensor) { this->active_zones_sensor_ = sensor; }
+        void set_load_deadband(float deadband) { this->load_deadband_ = deadband; }
+
+        void ingest(const LGAPResponse &frame);
+        // the zone stopped answering or was dropped from the zone map, its design load no longer counts
+        void remove(uint8_t zone);
+        void dump_config();
+
+        uint8_t get_total_load() const { return this->total_load_; }
+        uint16_t get_design_load_total() const { return this->design_load_total_; }
+        uint8_t get_active_zones() const { return this->active_zones_; }
+        // RX14 against the sum of the RX13 design loads, see protocol.md
+        float get_load_percent() const;
+
+      protected:
+        LGAPOduZone *find(uint8_t zone);
+        bool drop(uint8_t zone);
+        void update_totals();
+        void publish(bool force);
+
+        std::array<LGAPOduZone, LGAP_ODU_MAX_ZONES> zones_{};
+        uint8_t count_{0};
+
+        uint8_t total_load_{0};
+        uint16_t design_load_total_{0};
+        uint8_t active_zones_{0};
+        bool has_frame_{false};
+
+        float load_deadband_{0.0f};
+        sensor::Sensor *total_load_sensor_{nullptr};
+        sensor::Sensor *load_percent_sensor_{nullptr};
+        sensor::Sensor *design_load_total_sensor_{nullptr};
+        sensor::Sensor *active_zones_sensor_{nullptr};
+    };
+
+  } // namespace lgap
+} // namespace esphome
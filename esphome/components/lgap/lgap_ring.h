@@ -0,0 +1,47 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <stddef.h>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // fixed size single producer, single consumer queue. push() is only ever called from one thread and pop() from
+    // one other, so the two indexes are all that needs to be atomic. holds N - 1 items, one slot tells full from empty
+    template<typename T, size_t N> class LGAPRing
+    {
+      public:
+        bool push(const T &item)
+        {
+          size_t head = this->head_.load(std::memory_order_relaxed);
+          size_t next = (head + 1) % N;
+          if (next == this->tail_.load(std::memory_order_acquire))
+            return false;
+
+          this->items_[head] = item;
+          this->head_.store(next, std::memory_order_release);
+          return true;
+        }
+
+        bool pop(T &item)
+        {
+          size_t tail = this->tail_.load(std::memory_order_relaxed);
+          if (tail == this->head_.load(std::memory_order_acquire))
+            return false;
+
+          item = this->items_[tail];
+          this->tail_.store((tail + 1) % N, std::memory_order_release);
+          return true;
+        }
+
+        bool empty() const { return this->head_.load(std::memory_order_acquire) == this->tail_.load(std::memory_order_acquire); }
+
+      protected:
+        std::array<T, N> items_{};
+        std::atomic<size_t> head_{0};
+        std::atomic<size_t> tail_{0};
+    };
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <stdint.h>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // bus health counters, kept for the whole bus and for every zone
+    struct LGAPCounters
+    {
+      uint32_t transactions{0};
+      uint32_t timeouts{0};
+      uint32_t checksum_failures{0};
+      uint32_t resyncs{0};
+      uint32_t out_of_order{0};
+    };
+
+    // fixed bucket latency histogram, 64 buckets of 8ms covers everything up to the 500ms default receive_wait_time
+    class LGAPLatencyHistogram
+    {
+      public:
+        static const uint8_t BUCKET_COUNT = 64;
+        static const uint8_t BUCKET_WIDTH_MS = 8;
+
+        void record(uint32_t latency_ms)
+        {
+          uint32_t bucket = latency_ms / BUCKET_WIDTH_MS;
+          this->buckets_[bucket < BUCKET_COUNT ? bucket : BUCKET_COUNT - 1]++;
+          this->count_++;
+          if (latency_ms > this->max_)
+            this->max_ = latency_ms;
+        }
+
+        // upper edge of the bucket holding the given percentile (0-100), 0 when empty. the last bucket also holds
+        // everything slower, so a percentile landing there is reported as the slowest latency seen
+        uint32_t percentile(uint8_t percent) const
+        {
+          if (this->count_ == 0)
+            return 0;
+
+          uint32_t target = (this->count_ * percent + 99) / 100;
+          uint32_t seen = 0;
+          for (uint8_t i = 0; i < BUCKET_COUNT; i++)
+          {
+            seen += this->buckets_[i];
+            if (seen >= target)
+              return i + 1 < BUCKET_COUNT ? (i + 1) * BUCKET_WIDTH_MS : this->max_;
+          }
+          return this->max_;
+        }
+
+        uint32_t max() const { return this->max_; }
+        uint32_t count() const { return this->count_; }
+
+        void reset()
+        {
+          this->buckets_.fill(0);
+          this->count_ = 0;
+          this->max_ = 0;
+        }
+
+      protected:
+        std::array<uint32_t, BUCKET_COUNT> buckets_{};
+        uint32_t count_{0};
+        uint32_t max_{0};
+    };
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,132 @@
+#include "lgap_trace.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cinttypes>
+#include <cstring>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    const char *trace_outcome_to_string(TraceOutcome outcome)
+    {
+      switch (outcome)
+      {
+        case TRACE_OK:
+          return "ok";
+        case TRACE_TIMEOUT:
+          return "timeout";
+        case TRACE_CHECKSUM_FAILED:
+          return "bad checksum";
+        case TRACE_RESYNC:
+          return "resync";
+        case TRACE_UNMATCHED:
+          return "unmatched";
+        case TRACE_LATE:
+          return "late";
+      }
+      return "unknown";
+    }
+
+    uint8_t encode_capture_record(const LGAPTraceRecord &record, uint8_t *out)
+    {
+      out[0] = record.time & 0xFF;
+      out[1] = (record.time >> 8) & 0xFF;
+      out[2] = (record.time >> 16) & 0xFF;
+      out[3] = (record.time >> 24) & 0xFF;
+      out[4] = record.direction;
+      out[5] = record.outcome;
+      out[6] = record.length;
+      memcpy(out + LGAP_CAPTURE_HEADER_LENGTH, record.data, record.length);
+      return LGAP_CAPTURE_HEADER_LENGTH + record.length;
+    }
+
+    void LGAPTrace::set_size(uint16_t size)
+    {
+      this->records_.assign(size, LGAPTraceRecord{});
+      this->clear();
+    }
+
+    void LGAPTrace::record(TraceDirection direction, TraceOutcome outcome, const uint8_t *data, uint8_t length, uint32_t time)
+    {
+      if (this->records_.empty() && !this->streaming_)
+        return;
+
+      LGAPTraceRecord record;
+      record.time = time;
+      record.direction = direction;
+      record.outcome = outcome;
+      record.length = length > LGAP_RESPONSE_LENGTH ? LGAP_RESPONSE_LENGTH : length;
+      memcpy(record.data, data, record.length);
+
+      if (this->streaming_)
+        this->log_capture(record);
+      if (this->records_.empty())
+        return;
+
+      this->records_[this->head_] = record;
+      this->head_ = (this->head_ + 1) % this->records_.size();
+      if (this->count_ < this->records_.size())
+        this->count_++;
+    }
+
+    void LGAPTrace::record_event(TraceOutcome outcome, uint8_t request_id, uint8_t zone, uint32_t time)
+    {
+      uint8_t data[2] = {request_id, zone};
+      this->record(TRACE_EVENT, outcome, data, sizeof(data), time);
+    }
+
+    const LGAPTraceRecord &LGAPTrace::at(uint16_t index) const
+    {
+      // head_ is where the next record goes, which is also the oldest once the buffer has wrapped
+      uint16_t oldest = (this->head_ + this->records_.size() - this->count_) % this->records_.size();
+      return this->records_[(oldest + index) % this->records_.size()];
+    }
+
+    void LGAPTrace::clear()
+    {
+      this->head_ = 0;
+      this->count_ = 0;
+    }
+
+    void LGAPTrace::dump(const char *tag) const
+    {
+      if (this->records_.empty())
+      {
+        ESP_LOGW(tag, "Frame trace is disabled, set trace_size to enable it");
+        return;
+      }
+
+      ESP_LOGI(tag, "Frame trace, %d of %u records:", this->count_, (unsigned) this->records_.size());
+      static const char *const DIRECTIONS[] = {"TX", "RX", "--"};
+      for (uint16_t i = 0; i < this->count_; i++)
+      {
+        const LGAPTraceRecord &record = this->at(i);
+        if (record.direction == TRACE_EVENT)
+        {
+          ESP_LOGI(tag, "  %10" PRIu32 " -- %s, zone %d request 0x%02X", record.time, trace_outcome_to_string(record.outcome), record.data[1],
+                   record.data[0]);
+          continue;
+        }
+        ESP_LOGI(tag, "  %10" PRIu32 " %s %s (%s)", record.time, DIRECTIONS[record.direction], format_hex_pretty(record.data, record.length).c_str(),
+                 trace_outcome_to_string(record.outcome));
+      }
+    }
+
+    void LGAPTrace::dump_capture() const
+    {
+      ESP_LOGI(LGAP_CAPTURE_TAG, "%d records", this->count_);
+      for (uint16_t i = 0; i < this->count_; i++)
+        this->log_capture(this->at(i));
+    }
+
+    void LGAPTrace::log_capture(const LGAPTraceRecord &record) const
+    {
+      uint8_t packed[LGAP_CAPTURE_RECORD_MAX];
+      uint8_t length = encode_capture_record(record, packed);
+      ESP_LOGI(LGAP_CAPTURE_TAG, "%s", format_hex(packed, length).c_str());
+    }
+
+  } // namespace lgap
+} // namespace esphome
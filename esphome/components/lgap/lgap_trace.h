@@ -0,0 +1,89 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include "lgap_frame.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    enum TraceDirection : uint8_t
+    {
+      TRACE_TX,
+      TRACE_RX,
+      // not a frame, data holds the request id and zone the event is about
+      TRACE_EVENT
+    };
+
+    enum TraceOutcome : uint8_t
+    {
+      TRACE_OK,
+      TRACE_TIMEOUT,
+      TRACE_CHECKSUM_FAILED,
+      TRACE_RESYNC,
+      // a valid frame that matches no request
+      TRACE_UNMATCHED,
+      // a valid frame for a request that already timed out
+      TRACE_LATE
+    };
+
+    // one frame as it went over the wire, length is 0-16 so partial and stray bytes can be kept too
+    struct LGAPTraceRecord
+    {
+      uint32_t time{0};
+      TraceDirection direction{TRACE_TX};
+      TraceOutcome outcome{TRACE_OK};
+      uint8_t length{0};
+      uint8_t data[LGAP_RESPONSE_LENGTH]{};
+    };
+
+    const char *trace_outcome_to_string(TraceOutcome outcome);
+
+    // capture files are LGAP_CAPTURE_MAGIC followed by records packed little endian: time (4 bytes), direction,
+    // outcome, length, then length bytes. streamed captures are the same records hex encoded, one per log line
+    // under LGAP_CAPTURE_TAG. tools/lgap_capture.py reads both
+    static const char *const LGAP_CAPTURE_MAGIC = "LGAPCAP1";
+    static const char *const LGAP_CAPTURE_TAG = "lgap.capture";
+    static const uint8_t LGAP_CAPTURE_HEADER_LENGTH = 7;
+    static const uint8_t LGAP_CAPTURE_RECORD_MAX = LGAP_CAPTURE_HEADER_LENGTH + LGAP_RESPONSE_LENGTH;
+
+    // packs a record into out, which must hold LGAP_CAPTURE_RECORD_MAX bytes. returns the packed length
+    uint8_t encode_capture_record(const LGAPTraceRecord &record, uint8_t *out);
+
+    // the last size frames on the bus, raw and with no formatting, so recording costs a copy rather than a log line.
+    // the buffer is allocated once by set_size() and only dumped when asked to
+    class LGAPTrace
+    {
+      public:
+        void set_size(uint16_t size);
+        uint16_t get_size() const { return this->records_.size(); }
+        uint16_t get_count() const { return this->count_; }
+        bool is_enabled() const { return !this->records_.empty(); }
+
+        // time is millis() of when it happened on the wire, which with the bus task is earlier than when it's recorded
+        void record(TraceDirection direction, TraceOutcome outcome, const uint8_t *data, uint8_t length, uint32_t time);
+        void record_event(TraceOutcome outcome, uint8_t request_id, uint8_t zone, uint32_t time);
+        // oldest first, index 0 is the oldest record still held
+        const LGAPTraceRecord &at(uint16_t index) const;
+        void clear();
+
+        // every record held, oldest first, one log line each
+        void dump(const char *tag) const;
+        // the same records as capture lines, to pull an incident off the device after the fact
+        void dump_capture() const;
+
+        // log every new record as a capture line as it happens, works with the buffer disabled too
+        void set_streaming(bool streaming) { this->streaming_ = streaming; }
+        bool is_streaming() const { return this->streaming_; }
+
+      protected:
+        void log_capture(const LGAPTraceRecord &record) const;
+
+        std::vector<LGAPTraceRecord> records_{};
+        bool streaming_{false};
+        uint16_t head_{0};
+        uint16_t count_{0};
+    };
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,43 @@
+#include "lgap_transport.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    static const char *const TAG = "lgap.transport";
+
+    void LGAPLoopbackTransport::dump_config()
+    {
+      ESP_LOGCONFIG(TAG, "  Transport: %s, %u bytes waiting", this->get_summary().c_str(), (unsigned) this->rx_.size());
+    }
+
+    std::string LGAPLoopbackTransport::get_summary()
+    {
+      char summary[48];
+      snprintf(summary, sizeof(summary), "loopback, byte time %" PRIu32 "us", this->byte_time_us_);
+      return summary;
+    }
+
+    bool LGAPLoopbackTransport::read_array(uint8_t *data, size_t length)
+    {
+      if (this->rx_.size() < length)
+        return false;
+
+      std::copy(this->rx_.begin(), this->rx_.begin() + length, data);
+      this->rx_.erase(this->rx_.begin(), this->rx_.begin() + length);
+      return true;
+    }
+
+    void LGAPLoopbackTransport::write_array(const uint8_t *data, size_t length)
+    {
+      // with nothing listening the frame just goes nowhere, like a bus with no ODU on it
+      if (this->on_write_)
+        this->on_write_(data, length);
+    }
+
+  } // namespace lgap
+} // namespace esphome
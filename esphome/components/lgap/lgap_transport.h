@@ -0,0 +1,98 @@
+#pragma once
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "esphome/core/hal.h"
+#include "lgap_frame.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // slack on top of the frame's wire time before the driver enable is dropped, covers the uart fifo starting late
+    // or a bridge forwarding the frame a little after it was written
+    static const uint32_t LGAP_TX_RELEASE_GUARD_US = 500;
+
+    // the byte stream LGAP runs over. framing, request ids, scheduling and timeouts all stay in LGAP,
+    // a transport only moves bytes and knows how long one takes on the RS485 side
+    class LGAPTransport
+    {
+      public:
+        virtual ~LGAPTransport() = default;
+
+        virtual void setup() {}
+        // called at the start of every LGAP::loop(), before anything is read
+        virtual void loop() {}
+        virtual void dump_config() = 0;
+        // what the bus runs over in one line, settings only. LGAP takes it before the bus task owns the transport
+        virtual std::string get_summary() = 0;
+
+        virtual int available() = 0;
+        // reads exactly length bytes, false if fewer than that are available
+        virtual bool read_array(uint8_t *data, size_t length) = 0;
+        // a transport that can't send right now drops the frame, the request then times out like on a dead bus
+        virtual void write_array(const uint8_t *data, size_t length) = 0;
+        // blocks until everything written has left, for releasing the driver enable where there's no timer to do it
+        virtual void flush() {}
+
+        // time one byte takes on the RS485 wire, the scheduler's gaps and timeouts are built from it
+        virtual uint32_t get_byte_time_us() = 0;
+        // hand the RS485 driver enable to the transport's hardware, false when it can't drive pin itself
+        virtual bool set_hardware_driver_enable(GPIOPin *pin) { return false; }
+
+        // drains everything buffered in one pass so a frame completes as soon as its last byte lands, a chunk at a
+        // time and never past the end of the frame receiver is assembling. on_chunk(data, length, time) gets each
+        // chunk with the time it was read. LGAP::loop() and the bus task both read the wire through this
+        template<typename F> void read_frames(const LGAPFrameReceiver &receiver, F &&on_chunk)
+        {
+          uint8_t chunk[LGAP_RESPONSE_LENGTH];
+          while (true)
+          {
+            int available = this->available();
+            if (available <= 0)
+              return;
+            size_t length = std::min<size_t>(available, receiver.remaining());
+            if (!this->read_array(chunk, length))
+              return;
+            on_chunk(chunk, length, millis());
+          }
+        }
+
+        // a garbled frame leaves the stream position unknown, so everything buffered goes
+        void discard_buffered()
+        {
+          uint8_t discard;
+          while (this->available() > 0 && this->read_array(&discard, 1))
+            ;
+        }
+    };
+
+    // an in-memory bus for bench tests: frames LGAP writes go to the on_write callback,
+    // and feed() queues bytes for LGAP to read as if the ODU had sent them
+    class LGAPLoopbackTransport : public LGAPTransport
+    {
+      public:
+        void dump_config() override;
+        std::string get_summary() override;
+
+        int available() override { return this->rx_.size(); }
+        bool read_array(uint8_t *data, size_t length) override;
+        void write_array(const uint8_t *data, size_t length) override;
+        uint32_t get_byte_time_us() override { return this->byte_time_us_; }
+
+        void set_byte_time_us(uint32_t byte_time_us) { this->byte_time_us_ = byte_time_us; }
+        void set_on_write(std::function<void(const uint8_t *, size_t)> &&callback) { this->on_write_ = std::move(callback); }
+        void feed(const uint8_t *data, size_t length) { this->rx_.insert(this->rx_.end(), data, data + length); }
+
+      protected:
+        // 8N1 at 4800 baud
+        uint32_t byte_time_us_{2083};
+        std::deque<uint8_t> rx_{};
+        std::function<void(const uint8_t *, size_t)> on_write_{};
+    };
+
+  } // namespace lgap
+} // namespace esphome
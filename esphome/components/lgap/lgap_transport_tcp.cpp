@@ -0,0 +1,162 @@
+#include "lgap_transport_tcp.h"
+#ifdef USE_LGAP_TCP
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    static const char *const TAG = "lgap.transport";
+
+    void LGAPTCPTransport::setup()
+    {
+      this->address_length_ = socket::set_sockaddr((struct sockaddr *) &this->address_, sizeof(this->address_), this->host_, this->port_);
+      if (this->address_length_ == 0)
+        ESP_LOGE(TAG, "%s is not an IP address, the bridge can't be reached", this->host_.c_str());
+    }
+
+    void LGAPTCPTransport::dump_config()
+    {
+      ESP_LOGCONFIG(TAG, "  Transport: %s, %s", this->get_summary().c_str(), this->connected_ ? "connected" : "not connected");
+      ESP_LOGCONFIG(TAG, "  Reconnect interval: %" PRIu32 "ms", this->reconnect_interval_);
+    }
+
+    std::string LGAPTCPTransport::get_summary()
+    {
+      char summary[64];
+      snprintf(summary, sizeof(summary), "tcp to %s:%d, bridge at %" PRIu32 " baud", this->host_.c_str(), this->port_, this->baud_rate_);
+      return summary;
+    }
+
+    void LGAPTCPTransport::loop()
+    {
+      if (this->address_length_ == 0)
+        return;
+
+      uint32_t now = millis();
+      if (this->socket_ == nullptr)
+      {
+        if ((int32_t)(now - this->next_connect_) >= 0)
+          this->connect_();
+        return;
+      }
+
+      if (!this->connected_)
+      {
+        // a non-blocking connect carries on in the background, connecting again reports how it went
+        int result = this->socket_->connect((struct sockaddr *) &this->address_, this->address_length_);
+        if (result == 0 || errno == EISCONN)
+        {
+          ESP_LOGI(TAG, "Connected to %s:%d", this->host_.c_str(), this->port_);
+          this->connected_ = true;
+        }
+        else if (errno == EINPROGRESS || errno == EALREADY)
+        {
+          if ((now - this->connect_start_) > this->reconnect_interval_)
+            this->disconnect_("connect timed out");
+          return;
+        }
+        else
+        {
+          this->disconnect_(strerror(errno));
+          return;
+        }
+      }
+
+      // take whatever the bridge has sent, LGAP reads it out of rx_buffer_ in the same loop()
+      while (this->rx_length_ < sizeof(this->rx_buffer_))
+      {
+        ssize_t read = this->socket_->read(this->rx_buffer_ + this->rx_length_, sizeof(this->rx_buffer_) - this->rx_length_);
+        if (read > 0)
+        {
+          this->rx_length_ += read;
+          continue;
+        }
+
+        if (read == 0)
+          this->disconnect_("closed by the bridge");
+        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+          this->disconnect_(strerror(errno));
+        break;
+      }
+    }
+
+    bool LGAPTCPTransport::read_array(uint8_t *data, size_t length)
+    {
+      if (this->rx_length_ < length)
+        return false;
+
+      memcpy(data, this->rx_buffer_, length);
+      this->rx_length_ -= length;
+      memmove(this->rx_buffer_, this->rx_buffer_ + length, this->rx_length_);
+      return true;
+    }
+
+    void LGAPTCPTransport::write_array(const uint8_t *data, size_t length)
+    {
+      if (!this->connected_)
+        return;
+
+      // a request is 8 bytes, the socket buffer only fills up if the bridge has stopped reading
+      ssize_t written = this->socket_->write(data, length);
+      if (written == (ssize_t) length)
+        return;
+
+      if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+      {
+        this->disconnect_(strerror(errno));
+        return;
+      }
+      ESP_LOGW(TAG, "Only %d of %u bytes went to the bridge, the request will time out", written < 0 ? 0 : (int) written, (unsigned) length);
+    }
+
+    void LGAPTCPTransport::connect_()
+    {
+      this->connect_start_ = millis();
+      this->socket_ = socket::socket_ip(SOCK_STREAM, 0);
+      if (this->socket_ == nullptr)
+      {
+        this->disconnect_("no socket available");
+        return;
+      }
+
+      // requests are tiny and latency matters more than packing them
+      int enable = 1;
+      this->socket_->setsockopt(IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+      this->socket_->setblocking(false);
+
+      ESP_LOGD(TAG, "Connecting to %s:%d", this->host_.c_str(), this->port_);
+      if (this->socket_->connect((struct sockaddr *) &this->address_, this->address_length_) == 0)
+      {
+        ESP_LOGI(TAG, "Connected to %s:%d", this->host_.c_str(), this->port_);
+        this->connected_ = true;
+      }
+      else if (errno != EINPROGRESS)
+      {
+        this->disconnect_(strerror(errno));
+      }
+    }
+
+    void LGAPTCPTransport::disconnect_(const char *reason)
+    {
+      if (this->connected_)
+        ESP_LOGW(TAG, "Lost the connection to %s:%d: %s", this->host_.c_str(), this->port_, reason);
+      else
+        ESP_LOGW(TAG, "Could not connect to %s:%d: %s", this->host_.c_str(), this->port_, reason);
+
+      if (this->socket_ != nullptr)
+        this->socket_->close();
+      this->socket_.reset();
+      this->connected_ = false;
+      // a partial frame from the old connection would only confuse the next one
+      this->rx_length_ = 0;
+      this->next_connect_ = millis() + this->reconnect_interval_;
+    }
+
+  } // namespace lgap
+} // namespace esphome
+#endif
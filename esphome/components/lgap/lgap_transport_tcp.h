@@ -0,0 +1,61 @@
+#pragma once
+#include "esphome/core/defines.h"
+#ifdef USE_LGAP_TCP
+#include <memory>
+#include <string>
+#include "esphome/components/socket/socket.h"
+#include "lgap_transport.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // a raw TCP client to an Ethernet or WiFi RS485 bridge running in transparent mode. bytes pass straight
+    // through to the bus, so LGAP frames and times everything exactly as it would on a local uart.
+    // the socket is non-blocking and reconnects on its own. frames written while it's down are dropped,
+    // so the zones time out and back off as they would with the bus unplugged
+    class LGAPTCPTransport : public LGAPTransport
+    {
+      public:
+        void setup() override;
+        void loop() override;
+        void dump_config() override;
+        std::string get_summary() override;
+
+        int available() override { return this->rx_length_; }
+        bool read_array(uint8_t *data, size_t length) override;
+        void write_array(const uint8_t *data, size_t length) override;
+        bool is_connected() const { return this->connected_; }
+
+        // 8N1 at the bridge's serial baud rate, the network adds its own latency on top
+        uint32_t get_byte_time_us() override { return 10 * 1000000UL / this->baud_rate_; }
+
+        void set_host(const std::string &host) { this->host_ = host; }
+        void set_port(uint16_t port) { this->port_ = port; }
+        void set_baud_rate(uint32_t baud_rate) { this->baud_rate_ = baud_rate; }
+        void set_reconnect_interval(uint32_t time_in_ms) { this->reconnect_interval_ = time_in_ms; }
+
+      protected:
+        void connect_();
+        void disconnect_(const char *reason);
+
+        std::string host_{};
+        uint16_t port_{0};
+        uint32_t baud_rate_{4800};
+        uint32_t reconnect_interval_{5000};
+
+        std::unique_ptr<socket::Socket> socket_{nullptr};
+        struct sockaddr_storage address_{};
+        socklen_t address_length_{0};
+        bool connected_{false};
+        uint32_t connect_start_{0};
+        uint32_t next_connect_{0};
+
+        // bytes read off the socket that LGAP hasn't taken yet, a few frames' worth
+        uint8_t rx_buffer_[64];
+        size_t rx_length_{0};
+    };
+
+  } // namespace lgap
+} // namespace esphome
+#endif
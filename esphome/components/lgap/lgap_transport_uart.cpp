@@ -0,0 +1,64 @@
+#include "lgap_transport_uart.h"
+#ifdef USE_LGAP_UART
+#include "esphome/core/log.h"
+#include <cinttypes>
+#include <cstdio>
+#ifdef USE_ESP_IDF
+#include "esphome/components/uart/uart_component_esp_idf.h"
+#include <driver/uart.h>
+#endif
+
+namespace esphome
+{
+  namespace lgap
+  {
+    static const char *const TAG = "lgap.transport";
+
+    void LGAPUARTTransport::dump_config()
+    {
+      ESP_LOGCONFIG(TAG, "  Transport: %s", this->get_summary().c_str());
+      this->check_uart_settings(4800);
+    }
+
+    std::string LGAPUARTTransport::get_summary()
+    {
+      char summary[32];
+      snprintf(summary, sizeof(summary), "uart at %" PRIu32 " baud", this->parent_->get_baud_rate());
+      return summary;
+    }
+
+    uint32_t LGAPUARTTransport::get_byte_time_us()
+    {
+      // start + data + parity + stop bits on the wire for every byte
+      uint32_t bits = 1 + this->parent_->get_data_bits() + this->parent_->get_stop_bits() + (this->parent_->get_parity() != uart::UART_CONFIG_PARITY_NONE ? 1 : 0);
+      return (bits * 1000000UL) / this->parent_->get_baud_rate();
+    }
+
+    bool LGAPUARTTransport::set_hardware_driver_enable(GPIOPin *pin)
+    {
+#ifdef USE_ESP_IDF
+      // the uart peripheral raises RTS for exactly as long as it's sending, so the pin needs to be routed to it
+      if (pin == nullptr || !pin->is_internal())
+      {
+        ESP_LOGW(TAG, "native_rs485 needs an internal flow_control_pin");
+        return false;
+      }
+
+      auto *uart = static_cast<uart::IDFUARTComponent *>(this->parent_);
+      uart_port_t port = static_cast<uart_port_t>(uart->get_hw_serial_number());
+      int rts = static_cast<InternalGPIOPin *>(pin)->get_pin();
+      if (uart_set_pin(port, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, rts, UART_PIN_NO_CHANGE) != ESP_OK ||
+          uart_set_mode(port, UART_MODE_RS485_HALF_DUPLEX) != ESP_OK)
+      {
+        ESP_LOGW(TAG, "Could not put UART%d in rs485 half duplex mode", port);
+        return false;
+      }
+      return true;
+#else
+      return false;
+#endif
+    }
+
+  } // namespace lgap
+} // namespace esphome
+#endif
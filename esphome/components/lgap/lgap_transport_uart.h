@@ -0,0 +1,30 @@
+#pragma once
+#include "esphome/core/defines.h"
+#ifdef USE_LGAP_UART
+#include "esphome/components/uart/uart.h"
+#include "lgap_transport.h"
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // a local UART wired to an RS485 transceiver, the original way of talking to the ODU
+    class LGAPUARTTransport : public LGAPTransport, public uart::UARTDevice
+    {
+      public:
+        void dump_config() override;
+        std::string get_summary() override;
+
+        int available() override { return uart::UARTDevice::available(); }
+        bool read_array(uint8_t *data, size_t length) override { return uart::UARTDevice::read_array(data, length); }
+        void write_array(const uint8_t *data, size_t length) override { uart::UARTDevice::write_array(data, length); }
+        void flush() override { uart::UARTDevice::flush(); }
+
+        uint32_t get_byte_time_us() override;
+        // ESP32 with esp-idf only, puts the uart in rs485 half duplex mode with pin as RTS
+        bool set_hardware_driver_enable(GPIOPin *pin) override;
+    };
+
+  } // namespace lgap
+} // namespace esphome
+#endif
@@ -0,0 +1,81 @@
+#include "lgap.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cinttypes>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    void LGAP::set_state_key(const std::string &key)
+    {
+      // one record per bus, keyed on the component id
+      this->state_key_ = fnv1_hash("lgap_zone_state_" + key);
+    }
+
+    void LGAP::load_zone_states()
+    {
+      if (this->zone_states_loaded_)
+        return;
+      this->zone_states_loaded_ = true;
+
+      // zones restore from their own setup(), which can run before ours, so this loads on first use
+      this->zone_states_pref_ = global_preferences->make_preference<LGAPZoneStates>(this->state_key_, true);
+
+      LGAPZoneStates stored;
+      if (this->zone_states_pref_.load(&stored) && stored.version == LGAP_ZONE_STATE_VERSION && stored.count <= LGAP_ZONE_STATE_MAX_ZONES)
+      {
+        ESP_LOGI(TAG, "Loaded the last known state of %d zones", stored.count);
+        this->zone_states_ = stored;
+      }
+      this->zone_states_.version = LGAP_ZONE_STATE_VERSION;
+    }
+
+    bool LGAP::restore_zone_state(uint8_t zone, LGAPZoneState &state)
+    {
+      if (!this->warm_start_)
+        return false;
+
+      this->load_zone_states();
+      const LGAPZoneState *stored = this->zone_states_.find(zone);
+      if (stored == nullptr)
+        return false;
+
+      state = *stored;
+      return true;
+    }
+
+    void LGAP::store_zone_state(const LGAPZoneState &state)
+    {
+      if (!this->warm_start_)
+        return;
+
+      this->load_zone_states();
+      if (!this->zone_states_.update(state) || this->zone_states_save_pending_)
+        return;
+
+      // a burst of changes across any number of zones goes out as one write once the delay has passed
+      this->zone_states_save_pending_ = true;
+      this->set_timeout("zone_state_save", this->state_save_delay_, [this]() { this->save_zone_states(); });
+    }
+
+    void LGAP::save_zone_states()
+    {
+      this->zone_states_save_pending_ = false;
+      ESP_LOGD(TAG, "Saving the state of %d zones", this->zone_states_.count);
+      if (!this->zone_states_pref_.save(&this->zone_states_))
+        ESP_LOGW(TAG, "Failed to save zone states");
+    }
+
+    void LGAP::on_safe_shutdown()
+    {
+      // don't lose a change still waiting for its save, preferences are synced after this
+      if (!this->zone_states_save_pending_)
+        return;
+
+      this->cancel_timeout("zone_state_save");
+      this->save_zone_states();
+    }
+
+  } // namespace lgap
+} // namespace esphome
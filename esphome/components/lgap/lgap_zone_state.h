@@ -0,0 +1,85 @@
+#pragma once
+#include <stdint.h>
+
+namespace esphome
+{
+  namespace lgap
+  {
+    // bump whenever the layout of LGAPZoneStates changes so stale states are dropped instead of misread
+    static const uint8_t LGAP_ZONE_STATE_VERSION = 1;
+    static const uint8_t LGAP_ZONE_STATE_MAX_ZONES = 64;
+
+    // LGAPZoneState flags
+    static const uint8_t LGAP_ZONE_STATE_POWER = 0x01;
+    static const uint8_t LGAP_ZONE_STATE_CONTROL_LOCK = 0x02;
+    static const uint8_t LGAP_ZONE_STATE_PLASMA = 0x04;
+    static const uint8_t LGAP_ZONE_STATE_LOCK_TEMPERATURE = 0x08;
+    static const uint8_t LGAP_ZONE_STATE_LOCK_FAN_SPEED = 0x10;
+    static const uint8_t LGAP_ZONE_STATE_LOCK_MODE = 0x20;
+    static const uint8_t LGAP_ZONE_STATE_POWER_ONLY_MODE = 0x40;
+    // set before the zone first answered, only the lock flags are known and the rest of the record is empty
+    static const uint8_t LGAP_ZONE_STATE_LOCKS_ONLY = 0x80;
+
+    // the last decoded state of one zone, 5 bytes so every zone on a bus fits in one small preference
+    struct LGAPZoneState
+    {
+      uint8_t zone;
+      uint8_t flags;
+      // same layout as TX5/RX6, mode bits 0-2, swing bit 3, fan speed bits 4-6
+      uint8_t mode_fan;
+      // °C
+      uint8_t target_temperature;
+      int8_t room_temperature;
+
+      bool has(uint8_t flag) const { return (this->flags & flag) != 0; }
+      uint8_t mode() const { return this->mode_fan & 0x07; }
+      uint8_t swing() const { return (this->mode_fan >> 3) & 0x01; }
+      uint8_t fan_speed() const { return (this->mode_fan >> 4) & 0x07; }
+
+      // everything a user or the wall controller sets, the room temperature is only a measurement
+      bool same_control(const LGAPZoneState &other) const
+      {
+        return this->flags == other.flags && this->mode_fan == other.mode_fan && this->target_temperature == other.target_temperature;
+      }
+    };
+
+    // every zone on the bus, stored as-is in preferences so it must stay trivially copyable
+    struct LGAPZoneStates
+    {
+      uint8_t version{0};
+      uint8_t count{0};
+      LGAPZoneState zones[LGAP_ZONE_STATE_MAX_ZONES]{};
+
+      const LGAPZoneState *find(uint8_t zone) const
+      {
+        for (uint8_t i = 0; i < this->count; i++)
+        {
+          if (this->zones[i].zone == zone)
+            return &this->zones[i];
+        }
+        return nullptr;
+      }
+
+      // add or refresh a zone, returns true if a control field changed. a new room temperature is
+      // kept but doesn't count, it goes to flash with the next control change
+      bool update(const LGAPZoneState &state)
+      {
+        for (uint8_t i = 0; i < this->count; i++)
+        {
+          if (this->zones[i].zone != state.zone)
+            continue;
+          bool changed = !this->zones[i].same_control(state);
+          this->zones[i] = state;
+          return changed;
+        }
+
+        if (this->count >= LGAP_ZONE_STATE_MAX_ZONES)
+          return false;
+
+        this->zones[this->count++] = state;
+        return true;
+      }
+    };
+
+  } // namespace lgap
+} // namespace esphome
@@ -0,0 +1,154 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "fake_odu.h"
+#include "lgap/climate/lgap_climate.h"
+#include "lgap/lgap.h"
+#include "lgap/lgap_transport_uart.h"
+
+namespace lgap_test
+{
+  using namespace esphome;
+  using namespace esphome::lgap;
+
+  // LGAP with its internals opened up for the tests
+  class TestLGAP : public LGAP
+  {
+    public:
+      using LGAP::next_request_id;
+      using LGAP::get_response_timeout;
+      const LGAPCounters &counters() const { return this->counters_; }
+      uint8_t in_flight_count() const { return this->in_flight_count_; }
+      bool tx_active() const { return this->tx_active_; }
+      bool high_frequency() const { return this->high_freq_.is_started(); }
+      bool full_state_reached() const { return this->full_state_reached_; }
+      const LGAPZoneStates &zone_states() const { return this->zone_states_; }
+      uint32_t state_key() const { return this->state_key_; }
+      DiscoveryState discovery_state() const { return this->discovery_state_; }
+      void mark_in_flight(uint8_t slot, uint8_t request_id)
+      {
+        this->in_flight_[slot].state = IN_FLIGHT_PENDING;
+        this->in_flight_[slot].request_id = request_id;
+      }
+  };
+
+  class TestClimate : public LGAPHVACClimate
+  {
+    public:
+      using LGAPHVACClimate::apply_bulk;
+      bool has_response() const { return this->has_response_; }
+      uint8_t consecutive_failures() const { return this->consecutive_failures_; }
+      bool write_unconfirmed() const { return this->write_unconfirmed_; }
+      bool write_failed() const { return this->write_failed_; }
+      uint32_t write_failures() const { return this->write_failures_; }
+      uint8_t write_attempts() const { return this->write_attempts_; }
+      bool restored() const { return this->restored_; }
+      const LGAPCounters &counters() const { return this->counters_; }
+      uint8_t power_state() const { return this->power_state_; }
+      bool control_lock() const { return this->control_lock_; }
+      bool lock_temperature() const { return this->lock_temperature_; }
+  };
+
+  enum FixtureTransport
+  {
+    // the mock uart, the ODU answers on the simulated wire latency_ms after each request
+    FIXTURE_UART,
+    // the loopback, the ODU's answers are fed back a step after the request the way a bench test lambda would
+    FIXTURE_LOOPBACK
+  };
+
+  // one bus with a fake ODU on the other end, stepped a millisecond at a time
+  class BusFixture
+  {
+    public:
+      explicit BusFixture(FixtureTransport transport = FIXTURE_UART)
+      {
+        if (transport == FIXTURE_LOOPBACK)
+        {
+          this->loopback.set_on_write([this](const uint8_t *data, size_t length) {
+            std::vector<uint8_t> answer = this->odu.handle(data, length);
+            this->pending.insert(this->pending.end(), answer.begin(), answer.end());
+          });
+          this->bus.set_transport(&this->loopback);
+        }
+        else
+        {
+          this->odu.attach(&this->uart);
+          this->transport.set_uart_parent(&this->uart);
+          this->bus.set_transport(&this->transport);
+          this->bus.set_flow_control_pin(&this->driver_enable);
+        }
+        this->bus.set_state_key("bus");
+        // polls as fast as the bus allows unless a test slows it down
+        this->bus.set_loop_wait_time(0);
+      }
+
+      TestClimate *add_zone(int zone)
+      {
+        auto *climate = new TestClimate();
+        climate->set_zone_number(zone);
+        climate->set_parent(&this->bus);
+        this->bus.register_device(climate);
+        this->zones.emplace_back(climate);
+        return climate;
+      }
+
+      // setup() in ESPHome's order, the bus first
+      void setup()
+      {
+        this->bus.setup();
+        for (auto &zone : this->zones)
+          zone->setup();
+      }
+
+      // delay() moves the simulated clock, or sleeps for a millisecond under mock::set_realtime()
+      void step()
+      {
+        this->bus.loop();
+        for (auto &zone : this->zones)
+          zone->loop();
+        mock::run_scheduler();
+        delay(1);
+        if (this->answer && !this->pending.empty())
+        {
+          this->loopback.feed(this->pending.data(), this->pending.size());
+          this->pending.clear();
+        }
+      }
+
+      void run_for(uint32_t ms)
+      {
+        uint32_t end = millis() + ms;
+        while ((int32_t)(millis() - end) < 0)
+          this->step();
+      }
+
+      // steps until condition holds, false if it doesn't within timeout_ms
+      template<typename F> bool run_until(F condition, uint32_t timeout_ms)
+      {
+        uint32_t end = millis() + timeout_ms;
+        while (!condition())
+        {
+          if ((int32_t)(millis() - end) >= 0)
+            return false;
+          this->step();
+        }
+        return true;
+      }
+
+      uart::UARTComponent uart;
+      LGAPUARTTransport transport;
+      LGAPLoopbackTransport loopback;
+      GPIOPin driver_enable;
+      FakeOdu odu;
+      TestLGAP bus;
+      std::vector<std::unique_ptr<TestClimate>> zones{};
+      // FIXTURE_LOOPBACK only, answers waiting for the next step and whether they're fed at all
+      std::vector<uint8_t> pending{};
+      bool answer{true};
+  };
+
+} // namespace lgap_test
@@ -0,0 +1,102 @@
+#include "fake_odu.h"
+#include <cstring>
+
+namespace lgap_test
+{
+  using namespace esphome::lgap;
+
+  LGAPResponse FakeOdu::make_response(uint8_t request_id, uint8_t zone, const Zone &state)
+  {
+    LGAPResponse response;
+    response.data[0] = LGAP_RESPONSE_HEADER;
+    response.data[1] = state.flags | (state.connected ? 0x02 : 0x00);
+    response.data[2] = request_id;
+    response.data[3] = 0x40;
+    response.data[4] = zone;
+    response.data[6] = state.mode_fan;
+    response.data[7] = 0x40 | (state.target_raw & 0x0F);
+    response.data[8] = state.room_raw;
+    response.data[9] = 121;
+    response.data[10] = 122;
+    response.data[11] = 204;
+    response.data[12] = (state.flags & 0x01) ? 0 : 1;
+    response.data[13] = state.design_load;
+    response.data[14] = 51;
+    response.data[15] = calculate_checksum(response.data.data(), LGAP_RESPONSE_LENGTH);
+    return response;
+  }
+
+  void FakeOdu::apply_write_(uint8_t zone, const LGAPRequest &request)
+  {
+    Zone &state = this->zones[zone];
+    state.flags = request.control_flags() & 0x15;
+    state.mode_fan = request.mode_fan();
+    state.target_raw = request.target_temperature_raw() & 0x0F;
+  }
+
+  std::vector<uint8_t> FakeOdu::handle(const uint8_t *data, size_t length)
+  {
+    this->requests++;
+    if (length != LGAP_REQUEST_LENGTH)
+      return {};
+
+    LGAPRequest request;
+    memcpy(request.data.data(), data, LGAP_REQUEST_LENGTH);
+    this->seen.push_back(request);
+    if (request.checksum() != calculate_checksum(data, LGAP_REQUEST_LENGTH) || request.header() != this->header ||
+        request.request_id() < LGAP_REQUEST_ID_MIN)
+      return {};
+
+    auto it = this->zones.find(request.zone());
+    if (it == this->zones.end() || it->second.silent)
+      return {};
+
+    // a held back write shows up from the next request on
+    if (this->has_pending_write_)
+    {
+      this->apply_write_(this->pending_zone_, this->pending_write_);
+      this->has_pending_write_ = false;
+    }
+
+    LGAPResponse response = make_response(request.request_id(), request.zone(), it->second);
+    if (request.is_write())
+    {
+      this->writes++;
+      if (!it->second.ignore_writes)
+      {
+        if (this->stale_write_answer)
+        {
+          this->has_pending_write_ = true;
+          this->pending_zone_ = request.zone();
+          this->pending_write_ = request;
+        }
+        else
+        {
+          this->apply_write_(request.zone(), request);
+          response = make_response(request.request_id(), request.zone(), it->second);
+        }
+      }
+    }
+
+    this->answered++;
+    if (this->corrupt_next > 0)
+    {
+      this->corrupt_next--;
+      response.data[9] ^= 0x05;
+    }
+    return std::vector<uint8_t>(response.data.begin(), response.data.end());
+  }
+
+  void FakeOdu::attach(esphome::uart::UARTComponent *uart)
+  {
+    uart->set_on_write([this, uart](const uint8_t *data, size_t length) {
+      std::vector<uint8_t> response = this->handle(data, length);
+      if (response.empty())
+        return;
+      uint8_t zone = data[3];
+      uint32_t latency = this->latency_ms + this->zones[zone].extra_latency_ms;
+      uart->receive(response.data(), response.size(), uart->tx_end_us() + (uint64_t) latency * 1000);
+    });
+  }
+
+} // namespace lgap_test
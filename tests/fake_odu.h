@@ -0,0 +1,66 @@
+#pragma once
+#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "esphome/components/uart/uart.h"
+#include "lgap/lgap_frame.h"
+
+namespace lgap_test
+{
+  using esphome::lgap::LGAPRequest;
+  using esphome::lgap::LGAPResponse;
+
+  // the far end of the bus, answers requests the way the ODU does: only ids from 0xA0 up, only the header it
+  // was set up with, and only for zones it has
+  class FakeOdu
+  {
+    public:
+      struct Zone
+      {
+        bool connected{true};
+        // never answers, a zone configured but not wired
+        bool silent{false};
+        // answers, but doesn't take writes
+        bool ignore_writes{false};
+        // RX1 bits 0, 2 and 4, RX6 and the low nibble of RX7
+        uint8_t flags{0x00};
+        uint8_t mode_fan{0x10};
+        uint8_t target_raw{9};
+        uint8_t room_raw{120};
+        uint8_t design_load{24};
+        // extra delay for this zone on top of the ODU's latency
+        uint32_t extra_latency_ms{0};
+      };
+
+      Zone &add_zone(uint8_t zone) { return this->zones[zone]; }
+
+      // the response to a request, empty if the ODU stays quiet
+      std::vector<uint8_t> handle(const uint8_t *data, size_t length);
+      static LGAPResponse make_response(uint8_t request_id, uint8_t zone, const Zone &state);
+
+      // answers everything written to uart, latency_ms after the request has left the wire
+      void attach(esphome::uart::UARTComponent *uart);
+
+      uint8_t header{0x80};
+      uint32_t latency_ms{30};
+      // the answer to a write still carries the old state, like some wall controllers
+      bool stale_write_answer{false};
+      // the next answers go out with a byte flipped
+      uint32_t corrupt_next{0};
+      std::map<uint8_t, Zone> zones{};
+
+      uint32_t requests{0};
+      uint32_t writes{0};
+      uint32_t answered{0};
+      std::vector<LGAPRequest> seen{};
+
+    protected:
+      // a write taken but not yet shown, stale_write_answer only
+      bool has_pending_write_{false};
+      uint8_t pending_zone_{0};
+      LGAPRequest pending_write_{};
+      void apply_write_(uint8_t zone, const LGAPRequest &request);
+  };
+
+} // namespace lgap_test
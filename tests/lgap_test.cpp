@@ -0,0 +1,54 @@
+#include "lgap_test.h"
+#include <cstdio>
+#include <cstring>
+
+namespace lgap_test
+{
+  int failures = 0;
+
+  std::vector<TestCase> &registry()
+  {
+    static std::vector<TestCase> tests;
+    return tests;
+  }
+
+  void fail(const char *file, int line, const std::string &message)
+  {
+    failures++;
+    printf("  %s:%d: %s\n", file, line, message.c_str());
+  }
+
+  std::string describe(double value)
+  {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%g", value);
+    return buf;
+  }
+
+  std::string describe(const std::string &value) { return "\"" + value + "\""; }
+
+  std::string ref_path(const char *name) { return std::string(LGAP_REF_DIR) + "/" + name; }
+} // namespace lgap_test
+
+// runs every test in the binary, or only those whose name contains the first argument
+int main(int argc, char **argv)
+{
+  int failed = 0;
+  int run = 0;
+  for (auto &test : lgap_test::registry())
+  {
+    if (argc > 1 && strstr(test.name, argv[1]) == nullptr)
+      continue;
+
+    lgap_test::reset_environment();
+    lgap_test::failures = 0;
+    test.body();
+    run++;
+    printf("%s %s\n", lgap_test::failures == 0 ? "[  OK  ]" : "[ FAIL ]", test.name);
+    if (lgap_test::failures > 0)
+      failed++;
+  }
+
+  printf("%d tests, %d failed\n", run, failed);
+  return failed == 0 && run > 0 ? 0 : 1;
+}
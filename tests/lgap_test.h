@@ -0,0 +1,98 @@
+#pragma once
+// a few macros in the spirit of gtest, enough for the host tests without pulling in a framework
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/preferences.h"
+
+namespace lgap_test
+{
+  struct TestCase
+  {
+    const char *name;
+    std::function<void()> body;
+  };
+
+  std::vector<TestCase> &registry();
+  // failures in the test currently running
+  extern int failures;
+
+  struct Registrar
+  {
+    Registrar(const char *name, std::function<void()> body) { registry().push_back({name, std::move(body)}); }
+  };
+
+  void fail(const char *file, int line, const std::string &message);
+  std::string describe(double value);
+  std::string describe(const std::string &value);
+  inline std::string describe(const char *value) { return describe(std::string(value)); }
+
+  // every test starts at the same time with an empty scheduler and empty flash
+  inline void reset_environment()
+  {
+    esphome::mock::reset_scheduler();
+    esphome::mock::set_realtime(false);
+    esphome::mock::set_time_us(1000000);
+    esphome::global_preferences->clear();
+  }
+
+  // the path of a file in ref/
+  std::string ref_path(const char *name);
+} // namespace lgap_test
+
+#define TEST(name) \
+  static void test_##name(); \
+  static lgap_test::Registrar registrar_##name(#name, test_##name); \
+  static void test_##name()
+
+#define EXPECT_TRUE(condition) \
+  do \
+  { \
+    if (!(condition)) \
+      lgap_test::fail(__FILE__, __LINE__, "expected " #condition); \
+  } while (0)
+
+#define EXPECT_FALSE(condition) EXPECT_TRUE(!(condition))
+
+#define EXPECT_EQ(expected, actual) \
+  do \
+  { \
+    auto expected_ = (expected); \
+    auto actual_ = (actual); \
+    if (!(expected_ == actual_)) \
+      lgap_test::fail(__FILE__, __LINE__, \
+                      "expected " #actual " == " + lgap_test::describe(expected_) + ", got " + lgap_test::describe(actual_)); \
+  } while (0)
+
+#define EXPECT_NEAR(expected, actual, tolerance) \
+  do \
+  { \
+    double expected_ = (expected); \
+    double actual_ = (actual); \
+    if (!(std::fabs(expected_ - actual_) <= (tolerance))) \
+      lgap_test::fail(__FILE__, __LINE__, \
+                      "expected " #actual " within " #tolerance " of " + lgap_test::describe(expected_) + ", got " + lgap_test::describe(actual_)); \
+  } while (0)
+
+// comparisons that only make sense as a bound, e.g. a latency
+#define EXPECT_LE(bound, actual) \
+  do \
+  { \
+    double bound_ = (bound); \
+    double actual_ = (actual); \
+    if (!(actual_ <= bound_)) \
+      lgap_test::fail(__FILE__, __LINE__, "expected " #actual " <= " + lgap_test::describe(bound_) + ", got " + lgap_test::describe(actual_)); \
+  } while (0)
+
+#define EXPECT_GE(bound, actual) \
+  do \
+  { \
+    double bound_ = (bound); \
+    double actual_ = (actual); \
+    if (!(actual_ >= bound_)) \
+      lgap_test::fail(__FILE__, __LINE__, "expected " #actual " >= " + lgap_test::describe(bound_) + ", got " + lgap_test::describe(actual_)); \
+  } while (0)
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+  namespace binary_sensor
+  {
+    class BinarySensor : public EntityBase
+    {
+      public:
+        void publish_state(bool state)
+        {
+          this->state = state;
+          this->has_state_ = true;
+          this->publishes++;
+        }
+        void publish_initial_state(bool state) { this->publish_state(state); }
+        bool has_state() const { return this->has_state_; }
+
+        bool state{false};
+        uint32_t publishes{0};
+
+      protected:
+        bool has_state_{false};
+    };
+
+  } // namespace binary_sensor
+} // namespace esphome
@@ -0,0 +1,155 @@
+#pragma once
+#include <cmath>
+#include <set>
+#include <stdint.h>
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+
+namespace esphome
+{
+  namespace climate
+  {
+    enum ClimateMode : uint8_t
+    {
+      CLIMATE_MODE_OFF = 0,
+      CLIMATE_MODE_HEAT_COOL = 1,
+      CLIMATE_MODE_COOL = 2,
+      CLIMATE_MODE_HEAT = 3,
+      CLIMATE_MODE_FAN_ONLY = 4,
+      CLIMATE_MODE_DRY = 5,
+      CLIMATE_MODE_AUTO = 6,
+    };
+
+    enum ClimateFanMode : uint8_t
+    {
+      CLIMATE_FAN_ON = 0,
+      CLIMATE_FAN_OFF = 1,
+      CLIMATE_FAN_AUTO = 2,
+      CLIMATE_FAN_LOW = 3,
+      CLIMATE_FAN_MEDIUM = 4,
+      CLIMATE_FAN_HIGH = 5,
+      CLIMATE_FAN_MIDDLE = 6,
+      CLIMATE_FAN_FOCUS = 7,
+      CLIMATE_FAN_DIFFUSE = 8,
+      CLIMATE_FAN_QUIET = 9,
+    };
+
+    enum ClimateSwingMode : uint8_t
+    {
+      CLIMATE_SWING_OFF = 0,
+      CLIMATE_SWING_BOTH = 1,
+      CLIMATE_SWING_VERTICAL = 2,
+      CLIMATE_SWING_HORIZONTAL = 3,
+    };
+
+    enum ClimatePreset : uint8_t
+    {
+      CLIMATE_PRESET_NONE = 0,
+    };
+
+    class Climate;
+
+    class ClimateTraits
+    {
+      public:
+        void set_supports_current_temperature(bool supports) { this->supports_current_temperature = supports; }
+        void set_supports_two_point_target_temperature(bool supports) {}
+        void set_supports_current_humidity(bool supports) {}
+        void set_supports_target_humidity(bool supports) {}
+        void set_supported_modes(std::set<ClimateMode> modes) { this->supported_modes = std::move(modes); }
+        void set_supported_fan_modes(std::set<ClimateFanMode> modes) { this->supported_fan_modes = std::move(modes); }
+        void set_supported_swing_modes(std::set<ClimateSwingMode> modes) { this->supported_swing_modes = std::move(modes); }
+        void set_visual_min_temperature(float temperature) { this->visual_min_temperature = temperature; }
+        void set_visual_max_temperature(float temperature) { this->visual_max_temperature = temperature; }
+        void set_visual_temperature_step(float step) {}
+
+        bool supports_current_temperature{false};
+        std::set<ClimateMode> supported_modes{};
+        std::set<ClimateFanMode> supported_fan_modes{};
+        std::set<ClimateSwingMode> supported_swing_modes{};
+        float visual_min_temperature{10};
+        float visual_max_temperature{30};
+    };
+
+    class ClimateCall
+    {
+      public:
+        explicit ClimateCall(Climate *parent) : parent_(parent) {}
+
+        ClimateCall &set_mode(ClimateMode mode)
+        {
+          this->mode_ = mode;
+          return *this;
+        }
+        ClimateCall &set_fan_mode(ClimateFanMode fan_mode)
+        {
+          this->fan_mode_ = fan_mode;
+          return *this;
+        }
+        ClimateCall &set_swing_mode(ClimateSwingMode swing_mode)
+        {
+          this->swing_mode_ = swing_mode;
+          return *this;
+        }
+        ClimateCall &set_target_temperature(float target_temperature)
+        {
+          this->target_temperature_ = target_temperature;
+          return *this;
+        }
+        void perform();
+
+        const optional<ClimateMode> &get_mode() const { return this->mode_; }
+        const optional<ClimateFanMode> &get_fan_mode() const { return this->fan_mode_; }
+        const optional<ClimateSwingMode> &get_swing_mode() const { return this->swing_mode_; }
+        const optional<float> &get_target_temperature() const { return this->target_temperature_; }
+
+      protected:
+        Climate *parent_;
+        optional<ClimateMode> mode_;
+        optional<ClimateFanMode> fan_mode_;
+        optional<ClimateSwingMode> swing_mode_;
+        optional<float> target_temperature_;
+    };
+
+    // what Climate keeps in flash between boots
+    struct ClimateDeviceRestoreState
+    {
+      ClimateMode mode;
+      bool uses_fan_mode;
+      ClimateFanMode fan_mode;
+      ClimateSwingMode swing_mode;
+      float target_temperature;
+
+      ClimateCall to_call(Climate *climate);
+      void apply(Climate *climate);
+    };
+
+    class Climate : public EntityBase
+    {
+      public:
+        ClimateMode mode{CLIMATE_MODE_OFF};
+        optional<ClimateFanMode> fan_mode;
+        ClimateSwingMode swing_mode{CLIMATE_SWING_OFF};
+        optional<ClimatePreset> preset;
+        float current_temperature{NAN};
+        float target_temperature{NAN};
+
+        ClimateCall make_call() { return ClimateCall(this); }
+        // saves the state through the preference restore_state_() made, if it made one
+        void publish_state();
+        virtual ClimateTraits traits() = 0;
+
+        uint32_t publishes{0};
+
+      protected:
+        friend ClimateCall;
+        virtual void control(const ClimateCall &call) = 0;
+        optional<ClimateDeviceRestoreState> restore_state_();
+        void save_state_();
+
+        ESPPreferenceObject rtc_;
+    };
+
+  } // namespace climate
+} // namespace esphome
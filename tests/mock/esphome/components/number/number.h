@@ -0,0 +1,21 @@
+#pragma once
+#include <cmath>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+  namespace number
+  {
+    class Number : public EntityBase
+    {
+      public:
+        void publish_state(float state) { this->state = state; }
+
+        float state{NAN};
+
+      protected:
+        virtual void control(float value) = 0;
+    };
+
+  } // namespace number
+} // namespace esphome
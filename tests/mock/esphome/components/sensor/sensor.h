@@ -0,0 +1,34 @@
+#pragma once
+#include <cmath>
+#include <stdint.h>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+  namespace sensor
+  {
+    // no filters, so the raw state is the state
+    class Sensor : public EntityBase
+    {
+      public:
+        void publish_state(float state)
+        {
+          this->raw_state = state;
+          this->state = state;
+          this->has_state_ = true;
+          this->publishes++;
+        }
+        float get_state() const { return this->state; }
+        float get_raw_state() const { return this->raw_state; }
+        bool has_state() const { return this->has_state_; }
+
+        float state{NAN};
+        float raw_state{NAN};
+        uint32_t publishes{0};
+
+      protected:
+        bool has_state_{false};
+    };
+
+  } // namespace sensor
+} // namespace esphome
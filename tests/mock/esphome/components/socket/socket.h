@@ -0,0 +1,40 @@
+#pragma once
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdint.h>
+#include <string>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace esphome
+{
+  namespace socket
+  {
+    // the bsd socket implementation, straight onto the host's sockets
+    class Socket
+    {
+      public:
+        explicit Socket(int fd) : fd_(fd) {}
+        virtual ~Socket();
+
+        int connect(const struct sockaddr *addr, socklen_t addrlen) { return ::connect(this->fd_, addr, addrlen); }
+        ssize_t read(void *buf, size_t len) { return ::read(this->fd_, buf, len); }
+        ssize_t write(const void *buf, size_t len) { return ::send(this->fd_, buf, len, MSG_NOSIGNAL); }
+        int setsockopt(int level, int optname, const void *optval, socklen_t optlen) { return ::setsockopt(this->fd_, level, optname, optval, optlen); }
+        int setblocking(bool blocking);
+        int close();
+
+      protected:
+        int fd_;
+    };
+
+    std::unique_ptr<Socket> socket(int domain, int type, int protocol);
+    std::unique_ptr<Socket> socket_ip(int type, int protocol);
+    socklen_t set_sockaddr(struct sockaddr *addr, socklen_t addrlen, const std::string &ip_address, uint16_t port);
+
+  } // namespace socket
+} // namespace esphome
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include "esphome/core/component.h"
+
+namespace esphome
+{
+  namespace switch_
+  {
+    class Switch : public EntityBase
+    {
+      public:
+        // what home assistant calls, the switch publishes its new state from write_state()
+        void turn_on() { this->write_state(true); }
+        void turn_off() { this->write_state(false); }
+        void publish_state(bool state)
+        {
+          this->state = state;
+          this->publishes++;
+        }
+
+        bool state{false};
+        uint32_t publishes{0};
+
+      protected:
+        virtual void write_state(bool state) = 0;
+    };
+
+  } // namespace switch_
+} // namespace esphome
@@ -0,0 +1,93 @@
+#pragma once
+#include <deque>
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome
+{
+  namespace uart
+  {
+    enum UARTParityOptions
+    {
+      UART_CONFIG_PARITY_NONE,
+      UART_CONFIG_PARITY_EVEN,
+      UART_CONFIG_PARITY_ODD,
+    };
+
+    enum UARTFlushResult
+    {
+      UART_FLUSH_RESULT_SUCCESS,
+      UART_FLUSH_RESULT_ASSUMED_SUCCESS,
+      UART_FLUSH_RESULT_FAILED,
+      UART_FLUSH_RESULT_TIMEOUT,
+    };
+
+    // a uart with a wire behind it: written bytes take their byte time to go out, and bytes pushed with
+    // receive() only become readable once they have fully arrived
+    class UARTComponent
+    {
+      public:
+        uint32_t get_baud_rate() const { return this->baud_rate_; }
+        uint8_t get_stop_bits() const { return this->stop_bits_; }
+        uint8_t get_data_bits() const { return this->data_bits_; }
+        UARTParityOptions get_parity() const { return this->parity_; }
+        void set_baud_rate(uint32_t baud_rate) { this->baud_rate_ = baud_rate; }
+        void set_parity(UARTParityOptions parity) { this->parity_ = parity; }
+        uint32_t byte_time_us() const;
+
+        void write_array(const uint8_t *data, size_t length);
+        bool read_array(uint8_t *data, size_t length);
+        int available();
+        // blocks until the last byte written has left the shift register, here that moves the mock clock
+        UARTFlushResult flush();
+
+        // test side, bytes from the other end of the wire, the first one starting at start_us (now if 0)
+        void receive(const uint8_t *data, size_t length, uint64_t start_us = 0);
+        // test side, called with every frame written
+        void set_on_write(std::function<void(const uint8_t *, size_t)> &&callback) { this->on_write_ = std::move(callback); }
+        // micros() when the last byte written will have gone out
+        uint64_t tx_end_us() const { return this->tx_end_us_; }
+        uint32_t flushes{0};
+        std::vector<uint8_t> written{};
+
+      protected:
+        uint32_t baud_rate_{4800};
+        uint8_t stop_bits_{1};
+        uint8_t data_bits_{8};
+        UARTParityOptions parity_{UART_CONFIG_PARITY_NONE};
+        uint64_t tx_end_us_{0};
+        // (time fully received, byte)
+        std::deque<std::pair<uint64_t, uint8_t>> rx_{};
+        std::function<void(const uint8_t *, size_t)> on_write_{};
+    };
+
+    class UARTDevice
+    {
+      public:
+        UARTDevice() = default;
+        UARTDevice(UARTComponent *parent) : parent_(parent) {}
+        void set_uart_parent(UARTComponent *parent) { this->parent_ = parent; }
+
+        void write_byte(uint8_t data) { this->parent_->write_array(&data, 1); }
+        void write_array(const uint8_t *data, size_t length) { this->parent_->write_array(data, length); }
+        bool read_byte(uint8_t *data) { return this->parent_->read_array(data, 1); }
+        bool read_array(uint8_t *data, size_t length) { return this->parent_->read_array(data, length); }
+        int available() { return this->parent_->available(); }
+        UARTFlushResult flush() { return this->parent_->flush(); }
+        void check_uart_settings(uint32_t baud_rate, uint8_t stop_bits = 1, UARTParityOptions parity = UART_CONFIG_PARITY_NONE,
+                                 uint8_t data_bits = 8)
+        {
+        }
+
+      protected:
+        UARTComponent *parent_{nullptr};
+    };
+
+  } // namespace uart
+} // namespace esphome
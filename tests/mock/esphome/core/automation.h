@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include <tuple>
+#include <utility>
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome
+{
+  template<typename... Ts> class Trigger
+  {
+    public:
+      void trigger(Ts... x) { this->count++; }
+
+      uint32_t count{0};
+  };
+
+  template<typename... Ts> class Action
+  {
+    public:
+      virtual ~Action() = default;
+      void play_complex(Ts... x) { this->play(x...); }
+
+    protected:
+      virtual void play(Ts... x) = 0;
+  };
+
+  template<typename T, typename... X> class TemplatableValue
+  {
+    public:
+      TemplatableValue() = default;
+      TemplatableValue(T value) : value_(value), has_value_(true) {}
+
+      bool has_value() const { return this->has_value_; }
+      T value(X... x) const { return this->value_; }
+
+    protected:
+      T value_{};
+      bool has_value_{false};
+  };
+
+#define TEMPLATABLE_VALUE(type, name) \
+ protected: \
+  TemplatableValue<type, Ts...> name##_{}; \
+\
+ public: \
+  template<typename V> void set_##name(V name) { this->name##_ = name; }
+
+} // namespace esphome
@@ -0,0 +1,78 @@
+#pragma once
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+
+namespace esphome
+{
+  namespace setup_priority
+  {
+    extern const float BUS;
+    extern const float IO;
+    extern const float HARDWARE;
+    extern const float DATA;
+    extern const float PROCESSOR;
+    extern const float AFTER_WIFI;
+    extern const float AFTER_CONNECTION;
+    extern const float LATE;
+  } // namespace setup_priority
+
+  class Component
+  {
+    public:
+      virtual ~Component();
+      virtual void setup() {}
+      virtual void loop() {}
+      virtual void dump_config() {}
+      virtual float get_setup_priority() const { return 0.0f; }
+      virtual void on_shutdown() {}
+      virtual void on_safe_shutdown() {}
+
+      void mark_failed() { this->failed_ = true; }
+      bool is_failed() const { return this->failed_; }
+      void status_set_warning(const char *message = nullptr) {}
+      void status_clear_warning() {}
+
+    protected:
+      // same semantics as the real scheduler: a named timeout or interval replaces the one before it, the
+      // callbacks run from mock::run_scheduler() once the mock clock has passed their time
+      void set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f);
+      void set_timeout(uint32_t timeout, std::function<void()> &&f);
+      bool cancel_timeout(const std::string &name);
+      void set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f);
+      void set_interval(uint32_t interval, std::function<void()> &&f);
+      bool cancel_interval(const std::string &name);
+
+      bool failed_{false};
+  };
+
+  class PollingComponent : public Component
+  {
+    public:
+      virtual void update() = 0;
+  };
+
+  class EntityBase
+  {
+    public:
+      void set_name(const char *name) { this->name_ = name; }
+      const char *get_name() const { return this->name_.c_str(); }
+      std::string get_object_id() const { return this->name_; }
+      uint32_t get_object_id_hash() const { return fnv1_hash(this->name_); }
+
+    protected:
+      std::string name_{};
+  };
+
+  namespace mock
+  {
+    // runs every timeout and interval that's due, in the order they fall due
+    void run_scheduler();
+    // timeouts and intervals still scheduled
+    size_t scheduled_count();
+    // drop everything scheduled, between tests
+    void reset_scheduler();
+  } // namespace mock
+} // namespace esphome
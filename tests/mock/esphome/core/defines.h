@@ -0,0 +1,2 @@
+#pragma once
+// the host build is configured from tests/CMakeLists.txt instead, USE_HOST, USE_LGAP_UART and USE_LGAP_TCP
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdint.h>
+
+namespace esphome
+{
+  uint32_t millis();
+  uint32_t micros();
+  void delay(uint32_t ms);
+  void delayMicroseconds(uint32_t us);
+  void yield();
+
+  // records every level written so tests can see when the driver enable went up and down
+  class GPIOPin
+  {
+    public:
+      virtual ~GPIOPin() = default;
+      virtual void setup() {}
+      virtual void digital_write(bool value);
+      virtual void dump_summary() const {}
+      virtual bool is_internal() { return false; }
+
+      bool state{false};
+      uint32_t writes{0};
+      // micros() of the last rising and falling edge
+      uint32_t rise_time_us{0};
+      uint32_t fall_time_us{0};
+  };
+
+  class InternalGPIOPin : public GPIOPin
+  {
+    public:
+      bool is_internal() override { return true; }
+      virtual uint8_t get_pin() const { return 0; }
+  };
+
+  namespace mock
+  {
+    // the clock starts at 1s and only moves when a test moves it, unless set_realtime() hands it to the host clock
+    void set_time_us(uint64_t time_us);
+    void advance_us(uint64_t us);
+    inline void advance(uint32_t ms) { advance_us((uint64_t) ms * 1000); }
+    // for tests with a real thread, delay() sleeps and the clock follows the host's
+    void set_realtime(bool realtime);
+  } // namespace mock
+} // namespace esphome
@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <optional>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace esphome
+{
+  template<typename T> using optional = std::optional<T>;
+  using std::nullopt;
+
+  template<typename T> T clamp(T value, T min, T max) { return value < min ? min : (value > max ? max : value); }
+
+  uint32_t fnv1_hash(const std::string &str);
+  std::string str_upper_case(const std::string &str);
+  std::string format_hex(const uint8_t *data, size_t length);
+  std::string format_hex_pretty(const uint8_t *data, size_t length);
+
+  template<typename T> class Parented
+  {
+    public:
+      Parented() {}
+      Parented(T *parent) : parent_(parent) {}
+      T *get_parent() const { return this->parent_; }
+      void set_parent(T *parent) { this->parent_ = parent; }
+
+    protected:
+      T *parent_{nullptr};
+  };
+
+  template<typename... X> class CallbackManager;
+  template<typename... Ts> class CallbackManager<void(Ts...)>
+  {
+    public:
+      void add(std::function<void(Ts...)> &&callback) { this->callbacks_.push_back(std::move(callback)); }
+      void call(Ts... args)
+      {
+        for (auto &callback : this->callbacks_)
+          callback(args...);
+      }
+      size_t size() const { return this->callbacks_.size(); }
+
+    protected:
+      std::vector<std::function<void(Ts...)>> callbacks_;
+  };
+
+  // the real one makes the main loop spin without its usual sleep, here it only counts who is asking for that
+  class HighFrequencyLoopRequester
+  {
+    public:
+      void start();
+      void stop();
+      bool is_started() const { return this->started_; }
+      static bool is_high_frequency();
+
+    protected:
+      bool started_{false};
+  };
+
+} // namespace esphome
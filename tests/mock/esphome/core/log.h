@@ -0,0 +1,42 @@
+#pragma once
+#include <cinttypes>
+#include <stdint.h>
+
+namespace esphome
+{
+  namespace mock
+  {
+    // printf checked, so a wrong format specifier is a compiler warning on the host build too
+    void log(int level, const char *tag, const char *format, ...) __attribute__((format(printf, 3, 4)));
+    // LGAP_TEST_LOG=1..6 prints the log, it's silent by default
+    int log_level();
+    // lines logged under tag so far, at any level
+    uint32_t log_count(const char *tag);
+  } // namespace mock
+} // namespace esphome
+
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_CONFIG 4
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#define ESPHOME_LOG_LEVEL_VERY_VERBOSE 7
+
+#define ESP_LOGE(tag, ...) esphome::mock::log(ESPHOME_LOG_LEVEL_ERROR, tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) esphome::mock::log(ESPHOME_LOG_LEVEL_WARN, tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) esphome::mock::log(ESPHOME_LOG_LEVEL_INFO, tag, __VA_ARGS__)
+#define ESP_LOGCONFIG(tag, ...) esphome::mock::log(ESPHOME_LOG_LEVEL_CONFIG, tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) esphome::mock::log(ESPHOME_LOG_LEVEL_DEBUG, tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) esphome::mock::log(ESPHOME_LOG_LEVEL_VERBOSE, tag, __VA_ARGS__)
+#define ESP_LOGVV(tag, ...) esphome::mock::log(ESPHOME_LOG_LEVEL_VERY_VERBOSE, tag, __VA_ARGS__)
+
+#define LOG_SENSOR(prefix, type, obj) \
+  if ((obj) != nullptr) \
+    ESP_LOGCONFIG(TAG, "%s%s '%s'", prefix, type, (obj)->get_name())
+#define LOG_BINARY_SENSOR(prefix, type, obj) LOG_SENSOR(prefix, type, obj)
+#define LOG_BUTTON(prefix, type, obj) LOG_SENSOR(prefix, type, obj)
+
+#define YESNO(b) ((b) ? "YES" : "NO")
+#define ONOFF(b) ((b) ? "ON" : "OFF")
+#define TRUEFALSE(b) ((b) ? "TRUE" : "FALSE")
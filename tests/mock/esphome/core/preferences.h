@@ -0,0 +1,75 @@
+#pragma once
+#include <map>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+namespace esphome
+{
+  // an in-memory flash, every save is a copy of the struct under its key and counted
+  class ESPPreferences;
+
+  class ESPPreferenceObject
+  {
+    public:
+      ESPPreferenceObject() = default;
+      ESPPreferenceObject(ESPPreferences *preferences, uint32_t type, size_t length) : preferences_(preferences), type_(type), length_(length) {}
+
+      // like the real one, a preference that was never made saves and loads nothing
+      template<typename T> bool save(const T *src) { return this->save_(reinterpret_cast<const uint8_t *>(src), sizeof(T)); }
+      template<typename T> bool load(T *dest) { return this->load_(reinterpret_cast<uint8_t *>(dest), sizeof(T)); }
+
+    protected:
+      bool save_(const uint8_t *data, size_t length);
+      bool load_(uint8_t *data, size_t length);
+
+      ESPPreferences *preferences_{nullptr};
+      uint32_t type_{0};
+      size_t length_{0};
+  };
+
+  class ESPPreferences
+  {
+    public:
+      template<typename T> ESPPreferenceObject make_preference(uint32_t type, bool in_flash = false)
+      {
+        return ESPPreferenceObject(this, type, sizeof(T));
+      }
+      bool sync() { return true; }
+
+      void clear()
+      {
+        this->data.clear();
+        this->saves = 0;
+        this->saves_by_type.clear();
+      }
+
+      std::map<uint32_t, std::vector<uint8_t>> data{};
+      uint32_t saves{0};
+      std::map<uint32_t, uint32_t> saves_by_type{};
+  };
+
+  extern ESPPreferences *global_preferences;
+
+  inline bool ESPPreferenceObject::save_(const uint8_t *data, size_t length)
+  {
+    if (this->preferences_ == nullptr || length != this->length_)
+      return false;
+    this->preferences_->data[this->type_].assign(data, data + length);
+    this->preferences_->saves++;
+    this->preferences_->saves_by_type[this->type_]++;
+    return true;
+  }
+
+  inline bool ESPPreferenceObject::load_(uint8_t *data, size_t length)
+  {
+    if (this->preferences_ == nullptr)
+      return false;
+    auto it = this->preferences_->data.find(this->type_);
+    if (it == this->preferences_->data.end() || it->second.size() != length)
+      return false;
+    memcpy(data, it->second.data(), length);
+    return true;
+  }
+
+} // namespace esphome
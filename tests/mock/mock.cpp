@@ -0,0 +1,460 @@
+// the parts of ESPHome the lgap component uses, behaving closely enough to the real thing for the host tests
+#include "esphome/components/climate/climate.h"
+#include "esphome/components/socket/socket.h"
+#include "esphome/components/uart/uart.h"
+#include "esphome/core/component.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace esphome
+{
+  namespace setup_priority
+  {
+    const float BUS = 1000.0f;
+    const float IO = 900.0f;
+    const float HARDWARE = 800.0f;
+    const float DATA = 600.0f;
+    const float PROCESSOR = 400.0f;
+    const float AFTER_WIFI = 200.0f;
+    const float AFTER_CONNECTION = 100.0f;
+    const float LATE = -100.0f;
+  } // namespace setup_priority
+
+  // clock
+
+  static std::atomic<uint64_t> mock_time_us{1000000};
+  static std::atomic<bool> mock_realtime{false};
+  static std::chrono::steady_clock::time_point mock_realtime_origin;
+  static uint64_t mock_realtime_base_us{0};
+
+  static uint64_t now_us()
+  {
+    if (!mock_realtime.load())
+      return mock_time_us.load();
+    auto elapsed = std::chrono::steady_clock::now() - mock_realtime_origin;
+    return mock_realtime_base_us + std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  }
+
+  uint32_t millis() { return (uint32_t)(now_us() / 1000); }
+  uint32_t micros() { return (uint32_t) now_us(); }
+
+  void delay(uint32_t ms)
+  {
+    if (mock_realtime.load())
+      std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    else
+      mock::advance(ms);
+  }
+
+  void delayMicroseconds(uint32_t us)
+  {
+    if (mock_realtime.load())
+      std::this_thread::sleep_for(std::chrono::microseconds(us));
+    else
+      mock::advance_us(us);
+  }
+
+  void yield() {}
+
+  void GPIOPin::digital_write(bool value)
+  {
+    if (value != this->state)
+    {
+      if (value)
+        this->rise_time_us = micros();
+      else
+        this->fall_time_us = micros();
+    }
+    this->state = value;
+    this->writes++;
+  }
+
+  namespace mock
+  {
+    void set_time_us(uint64_t time_us) { mock_time_us = time_us; }
+    void advance_us(uint64_t us) { mock_time_us += us; }
+
+    void set_realtime(bool realtime)
+    {
+      if (realtime == mock_realtime.load())
+        return;
+      if (realtime)
+      {
+        mock_realtime_base_us = mock_time_us.load();
+        mock_realtime_origin = std::chrono::steady_clock::now();
+      }
+      else
+      {
+        mock_time_us = now_us();
+      }
+      mock_realtime = realtime;
+    }
+  } // namespace mock
+
+  // logging
+
+  static std::mutex log_mutex;
+  static std::map<std::string, uint32_t> log_counts;
+
+  namespace mock
+  {
+    int log_level()
+    {
+      static int level = getenv("LGAP_TEST_LOG") != nullptr ? atoi(getenv("LGAP_TEST_LOG")) : 0;
+      return level;
+    }
+
+    void log(int level, const char *tag, const char *format, ...)
+    {
+      std::lock_guard<std::mutex> lock(log_mutex);
+      log_counts[tag]++;
+      if (level > log_level())
+        return;
+
+      static const char LEVELS[] = "?EWICDVV";
+      printf("[%8" PRIu32 "][%c][%s] ", millis(), LEVELS[level < 8 ? level : 0], tag);
+      va_list args;
+      va_start(args, format);
+      vprintf(format, args);
+      va_end(args);
+      printf("\n");
+    }
+
+    uint32_t log_count(const char *tag)
+    {
+      std::lock_guard<std::mutex> lock(log_mutex);
+      auto it = log_counts.find(tag);
+      return it == log_counts.end() ? 0 : it->second;
+    }
+  } // namespace mock
+
+  // helpers
+
+  uint32_t fnv1_hash(const std::string &str)
+  {
+    uint32_t hash = 2166136261UL;
+    for (char c : str)
+    {
+      hash *= 16777619UL;
+      hash ^= (uint8_t) c;
+    }
+    return hash;
+  }
+
+  std::string str_upper_case(const std::string &str)
+  {
+    std::string upper = str;
+    for (auto &c : upper)
+      c = toupper(c);
+    return upper;
+  }
+
+  std::string format_hex(const uint8_t *data, size_t length)
+  {
+    std::string hex;
+    char buf[3];
+    for (size_t i = 0; i < length; i++)
+    {
+      snprintf(buf, sizeof(buf), "%02x", data[i]);
+      hex += buf;
+    }
+    return hex;
+  }
+
+  std::string format_hex_pretty(const uint8_t *data, size_t length)
+  {
+    std::string hex;
+    char buf[4];
+    for (size_t i = 0; i < length; i++)
+    {
+      snprintf(buf, sizeof(buf), i + 1 < length ? "%02X." : "%02X", data[i]);
+      hex += buf;
+    }
+    return hex;
+  }
+
+  static std::atomic<int> high_frequency_requests{0};
+
+  void HighFrequencyLoopRequester::start()
+  {
+    if (this->started_)
+      return;
+    this->started_ = true;
+    high_frequency_requests++;
+  }
+
+  void HighFrequencyLoopRequester::stop()
+  {
+    if (!this->started_)
+      return;
+    this->started_ = false;
+    high_frequency_requests--;
+  }
+
+  bool HighFrequencyLoopRequester::is_high_frequency() { return high_frequency_requests.load() > 0; }
+
+  ESPPreferences *global_preferences = new ESPPreferences();
+
+  // scheduler
+
+  struct ScheduledItem
+  {
+    uint32_t due;
+    uint32_t interval;
+    // items scheduled at the same time run in the order they were added
+    uint64_t sequence;
+    std::function<void()> callback;
+  };
+
+  // keyed on the component and the name, anonymous items get a name of their own
+  using SchedulerKey = std::pair<const Component *, std::string>;
+  static std::map<SchedulerKey, ScheduledItem> scheduler_items;
+  static uint64_t scheduler_sequence{0};
+
+  static void schedule(const Component *component, const std::string &name, uint32_t delay, uint32_t interval, std::function<void()> &&f)
+  {
+    std::string key = name.empty() ? "#" + std::to_string(scheduler_sequence) : name;
+    scheduler_items[{component, key}] = ScheduledItem{millis() + delay, interval, scheduler_sequence++, std::move(f)};
+  }
+
+  Component::~Component()
+  {
+    for (auto it = scheduler_items.begin(); it != scheduler_items.end();)
+    {
+      if (it->first.first == this)
+        it = scheduler_items.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) { schedule(this, name, timeout, 0, std::move(f)); }
+  void Component::set_timeout(uint32_t timeout, std::function<void()> &&f) { schedule(this, "", timeout, 0, std::move(f)); }
+  bool Component::cancel_timeout(const std::string &name) { return scheduler_items.erase({this, name}) > 0; }
+  void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) { schedule(this, name, interval, interval, std::move(f)); }
+  void Component::set_interval(uint32_t interval, std::function<void()> &&f) { schedule(this, "", interval, interval, std::move(f)); }
+  bool Component::cancel_interval(const std::string &name) { return scheduler_items.erase({this, name}) > 0; }
+
+  namespace mock
+  {
+    void run_scheduler()
+    {
+      // one item at a time, a callback may add or cancel others
+      while (true)
+      {
+        uint32_t now = millis();
+        auto next = scheduler_items.end();
+        for (auto it = scheduler_items.begin(); it != scheduler_items.end(); ++it)
+        {
+          if ((int32_t)(now - it->second.due) < 0)
+            continue;
+          if (next == scheduler_items.end() || (int32_t)(it->second.due - next->second.due) < 0 ||
+              (it->second.due == next->second.due && it->second.sequence < next->second.sequence))
+            next = it;
+        }
+        if (next == scheduler_items.end())
+          return;
+
+        std::function<void()> callback = next->second.callback;
+        if (next->second.interval > 0)
+        {
+          next->second.due += next->second.interval;
+          next->second.sequence = scheduler_sequence++;
+        }
+        else
+        {
+          scheduler_items.erase(next);
+        }
+        callback();
+      }
+    }
+
+    size_t scheduled_count() { return scheduler_items.size(); }
+
+    void reset_scheduler() { scheduler_items.clear(); }
+  } // namespace mock
+
+  // uart
+
+  namespace uart
+  {
+    uint32_t UARTComponent::byte_time_us() const
+    {
+      uint32_t bits = 1 + this->data_bits_ + this->stop_bits_ + (this->parity_ != UART_CONFIG_PARITY_NONE ? 1 : 0);
+      return bits * 1000000UL / this->baud_rate_;
+    }
+
+    void UARTComponent::write_array(const uint8_t *data, size_t length)
+    {
+      // queued behind whatever is still going out
+      uint64_t now = now_us();
+      this->tx_end_us_ = (this->tx_end_us_ > now ? this->tx_end_us_ : now) + (uint64_t) length * this->byte_time_us();
+      this->written.insert(this->written.end(), data, data + length);
+      if (this->on_write_)
+        this->on_write_(data, length);
+    }
+
+    bool UARTComponent::read_array(uint8_t *data, size_t length)
+    {
+      if ((size_t) this->available() < length)
+        return false;
+      for (size_t i = 0; i < length; i++)
+      {
+        data[i] = this->rx_.front().second;
+        this->rx_.pop_front();
+      }
+      return true;
+    }
+
+    int UARTComponent::available()
+    {
+      uint64_t now = now_us();
+      int count = 0;
+      for (auto &entry : this->rx_)
+      {
+        if (entry.first > now)
+          break;
+        count++;
+      }
+      return count;
+    }
+
+    UARTFlushResult UARTComponent::flush()
+    {
+      this->flushes++;
+      uint64_t now = now_us();
+      if (this->tx_end_us_ > now)
+        mock::advance_us(this->tx_end_us_ - now);
+      return UART_FLUSH_RESULT_SUCCESS;
+    }
+
+    void UARTComponent::receive(const uint8_t *data, size_t length, uint64_t start_us)
+    {
+      uint64_t time = start_us != 0 ? start_us : now_us();
+      // the wire carries one byte at a time, a second frame queues behind the first
+      if (!this->rx_.empty() && this->rx_.back().first > time)
+        time = this->rx_.back().first;
+      for (size_t i = 0; i < length; i++)
+      {
+        time += this->byte_time_us();
+        this->rx_.push_back({time, data[i]});
+      }
+    }
+  } // namespace uart
+
+  // climate
+
+  namespace climate
+  {
+    void ClimateCall::perform() { this->parent_->control(*this); }
+
+    ClimateCall ClimateDeviceRestoreState::to_call(Climate *climate)
+    {
+      auto call = climate->make_call();
+      call.set_mode(this->mode);
+      call.set_target_temperature(this->target_temperature);
+      if (this->uses_fan_mode)
+        call.set_fan_mode(this->fan_mode);
+      call.set_swing_mode(this->swing_mode);
+      return call;
+    }
+
+    void ClimateDeviceRestoreState::apply(Climate *climate)
+    {
+      climate->mode = this->mode;
+      climate->target_temperature = this->target_temperature;
+      if (this->uses_fan_mode)
+        climate->fan_mode = this->fan_mode;
+      climate->swing_mode = this->swing_mode;
+      climate->publish_state();
+    }
+
+    void Climate::publish_state()
+    {
+      this->publishes++;
+      this->save_state_();
+    }
+
+    optional<ClimateDeviceRestoreState> Climate::restore_state_()
+    {
+      this->rtc_ = global_preferences->make_preference<ClimateDeviceRestoreState>(this->get_object_id_hash());
+      ClimateDeviceRestoreState recovered{};
+      if (!this->rtc_.load(&recovered))
+        return {};
+      return recovered;
+    }
+
+    void Climate::save_state_()
+    {
+      ClimateDeviceRestoreState state{};
+      state.mode = this->mode;
+      state.target_temperature = this->target_temperature;
+      state.uses_fan_mode = this->fan_mode.has_value();
+      if (state.uses_fan_mode)
+        state.fan_mode = *this->fan_mode;
+      state.swing_mode = this->swing_mode;
+      this->rtc_.save(&state);
+    }
+  } // namespace climate
+
+  // socket
+
+  namespace socket
+  {
+    Socket::~Socket()
+    {
+      if (this->fd_ >= 0)
+        ::close(this->fd_);
+    }
+
+    int Socket::setblocking(bool blocking)
+    {
+      int flags = fcntl(this->fd_, F_GETFL);
+      return fcntl(this->fd_, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+    }
+
+    int Socket::close()
+    {
+      int result = ::close(this->fd_);
+      this->fd_ = -1;
+      return result;
+    }
+
+    std::unique_ptr<Socket> socket(int domain, int type, int protocol)
+    {
+      int fd = ::socket(domain, type, protocol);
+      if (fd < 0)
+        return nullptr;
+      return std::unique_ptr<Socket>(new Socket(fd));
+    }
+
+    std::unique_ptr<Socket> socket_ip(int type, int protocol) { return socket(AF_INET, type, protocol); }
+
+    socklen_t set_sockaddr(struct sockaddr *addr, socklen_t addrlen, const std::string &ip_address, uint16_t port)
+    {
+      auto *in = reinterpret_cast<struct sockaddr_in *>(addr);
+      if (addrlen < sizeof(*in))
+        return 0;
+      memset(in, 0, sizeof(*in));
+      in->sin_family = AF_INET;
+      in->sin_port = htons(port);
+      if (inet_pton(AF_INET, ip_address.c_str(), &in->sin_addr) != 1)
+        return 0;
+      return sizeof(*in);
+    }
+  } // namespace socket
+
+} // namespace esphome
@@ -0,0 +1,288 @@
+// the LGAP state machine against a fake ODU: request ids, matching, timeouts, zone health and the driver enable
+#include <cinttypes>
+#include <set>
+#include "bus_fixture.h"
+#include "lgap_test.h"
+
+using namespace lgap_test;
+
+TEST(request_ids_rotate_through_0xa0_to_0xff)
+{
+  TestLGAP bus;
+  EXPECT_EQ(0xA0, bus.next_request_id());
+  uint8_t previous = 0xA0;
+  for (int i = 0; i < 300; i++)
+  {
+    uint8_t id = bus.next_request_id();
+    EXPECT_GE(LGAP_REQUEST_ID_MIN, id);
+    EXPECT_EQ(previous == 0xFF ? LGAP_REQUEST_ID_MIN : previous + 1, id);
+    previous = id;
+  }
+}
+
+TEST(request_ids_skip_those_still_in_flight)
+{
+  TestLGAP bus;
+  bus.mark_in_flight(0, 0xA1);
+  bus.mark_in_flight(1, 0xA2);
+  EXPECT_EQ(0xA0, bus.next_request_id());
+  EXPECT_EQ(0xA3, bus.next_request_id());
+
+  // every id taken, the rotation still terminates
+  TestLGAP full;
+  for (uint8_t slot = 0; slot < LGAP_IN_FLIGHT_SLOTS; slot++)
+    full.mark_in_flight(slot, 0xA0 + slot);
+  std::set<uint8_t> seen;
+  for (int i = 0; i < 96; i++)
+    seen.insert(full.next_request_id());
+  EXPECT_EQ(96u - LGAP_IN_FLIGHT_SLOTS, seen.size());
+}
+
+TEST(latency_percentiles_past_the_last_bucket_report_the_slowest)
+{
+  LGAPLatencyHistogram histogram;
+  for (int i = 0; i < 90; i++)
+    histogram.record(30);
+  for (int i = 0; i < 10; i++)
+    histogram.record(1500);
+
+  EXPECT_EQ(32u, histogram.percentile(50));
+  EXPECT_EQ(32u, histogram.percentile(90));
+  // not the 512ms edge of the last bucket
+  EXPECT_EQ(1500u, histogram.percentile(95));
+  EXPECT_EQ(1500u, histogram.max());
+}
+
+TEST(every_zone_is_polled_and_decoded)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1).target_raw = 6;
+  fixture.odu.add_zone(2).flags = 0x01;
+  fixture.odu.add_zone(3).mode_fan = 0x34;
+  auto *zone1 = fixture.add_zone(1);
+  auto *zone2 = fixture.add_zone(2);
+  auto *zone3 = fixture.add_zone(3);
+  fixture.setup();
+
+  EXPECT_TRUE(fixture.run_until([&]() { return zone1->has_response() && zone2->has_response() && zone3->has_response(); }, 2000));
+  fixture.run_for(3000);
+
+  EXPECT_EQ(0u, fixture.bus.counters().timeouts);
+  EXPECT_EQ(0u, fixture.bus.counters().checksum_failures);
+  EXPECT_EQ(0u, fixture.bus.counters().out_of_order);
+  // the last answer may still be on the wire
+  EXPECT_LE(fixture.odu.answered, fixture.bus.counters().transactions);
+  EXPECT_GE(fixture.odu.answered - 1, fixture.bus.counters().transactions);
+  for (const auto &request : fixture.odu.seen)
+  {
+    EXPECT_EQ(0x80, request.header());
+    EXPECT_GE(LGAP_REQUEST_ID_MIN, request.request_id());
+    EXPECT_FALSE(request.is_write());
+  }
+
+  EXPECT_EQ(21.0f, zone1->target_temperature);
+  EXPECT_EQ(climate::CLIMATE_MODE_OFF, zone1->mode);
+  EXPECT_EQ(climate::CLIMATE_MODE_COOL, zone2->mode);
+  EXPECT_EQ(climate::CLIMATE_FAN_LOW, *zone2->fan_mode);
+  EXPECT_EQ(climate::CLIMATE_FAN_HIGH, *zone3->fan_mode);
+  // (192 - 120) / 3
+  EXPECT_EQ(24.0f, zone1->current_temperature);
+  EXPECT_TRUE(zone1->is_available());
+}
+
+TEST(silent_zone_backs_off_and_goes_unavailable)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1);
+  fixture.odu.add_zone(2).silent = true;
+  auto *zone1 = fixture.add_zone(1);
+  auto *zone2 = fixture.add_zone(2);
+  fixture.bus.set_unavailable_after(3);
+  fixture.setup();
+
+  fixture.run_for(10000);
+  EXPECT_TRUE(zone1->is_available());
+  EXPECT_FALSE(zone2->is_available());
+  EXPECT_FALSE(zone2->has_response());
+  EXPECT_GE(3, zone2->consecutive_failures());
+  EXPECT_EQ(zone2->counters().timeouts, fixture.bus.counters().timeouts);
+  EXPECT_EQ(0u, zone1->counters().timeouts);
+
+  // backing off leaves the bus to the zone that answers
+  EXPECT_GE(10 * zone2->counters().transactions, zone1->counters().transactions);
+
+  // back on the bus, it's picked up again once its backoff runs out
+  fixture.odu.zones[2].silent = false;
+  EXPECT_TRUE(fixture.run_until([&]() { return zone2->is_available(); }, 70000));
+  EXPECT_EQ(0, zone2->consecutive_failures());
+}
+
+TEST(disconnected_idu_counts_against_the_zone)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1).connected = false;
+  auto *zone1 = fixture.add_zone(1);
+  fixture.setup();
+
+  fixture.run_for(10000);
+  EXPECT_TRUE(zone1->has_response());
+  EXPECT_FALSE(zone1->is_available());
+  EXPECT_EQ(0u, fixture.bus.counters().timeouts);
+}
+
+TEST(corrupt_answer_counts_as_checksum_failure)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1);
+  auto *zone1 = fixture.add_zone(1);
+  fixture.odu.corrupt_next = 1;
+  fixture.setup();
+
+  fixture.run_for(2000);
+  EXPECT_EQ(1u, fixture.bus.counters().checksum_failures);
+  EXPECT_EQ(1u, zone1->counters().checksum_failures);
+  EXPECT_EQ(0u, fixture.bus.counters().timeouts);
+  // a garbled frame is a bus problem, not the zone's
+  EXPECT_TRUE(zone1->is_available());
+  EXPECT_TRUE(zone1->has_response());
+}
+
+TEST(late_answer_still_reaches_its_zone)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1).extra_latency_ms = 400;
+  auto *zone1 = fixture.add_zone(1);
+  fixture.bus.set_receive_wait_time(300);
+  fixture.bus.set_boot_sweep(false);
+  fixture.setup();
+
+  EXPECT_TRUE(fixture.run_until([&]() { return zone1->has_response(); }, 2000));
+  EXPECT_GE(1, fixture.bus.counters().timeouts);
+  EXPECT_GE(1, fixture.bus.counters().out_of_order);
+}
+
+TEST(driver_enable_covers_exactly_the_request)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1);
+  auto *zone1 = fixture.add_zone(1);
+  fixture.setup();
+  EXPECT_FALSE(fixture.driver_enable.state);
+
+  // the host has no release timer, so this is the flush fallback, the pin is already down when loop() returns
+  uint32_t writes = fixture.driver_enable.writes;
+  EXPECT_TRUE(fixture.run_until([&]() { return fixture.driver_enable.writes >= writes + 2; }, 100));
+  EXPECT_FALSE(fixture.driver_enable.state);
+  uint64_t tx_end = fixture.uart.tx_end_us();
+
+  // up for the whole frame and released before the ODU starts its answer
+  uint32_t frame_us = LGAP_REQUEST_LENGTH * fixture.uart.byte_time_us();
+  uint32_t held_us = fixture.driver_enable.fall_time_us - fixture.driver_enable.rise_time_us;
+  EXPECT_GE(frame_us, held_us);
+  EXPECT_GE((uint32_t) tx_end, fixture.driver_enable.fall_time_us);
+  EXPECT_LE(tx_end + fixture.odu.latency_ms * 1000, fixture.driver_enable.fall_time_us);
+  EXPECT_TRUE(fixture.run_until([&]() { return zone1->has_response(); }, 200));
+}
+
+TEST(loop_runs_flat_out_while_a_frame_is_going_out)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1);
+  auto *zone1 = fixture.add_zone(1);
+  fixture.setup();
+  EXPECT_FALSE(fixture.bus.high_frequency());
+
+  EXPECT_TRUE(fixture.run_until([&]() { return fixture.bus.tx_active(); }, 100));
+  EXPECT_TRUE(fixture.bus.high_frequency());
+  // released on time even if the next loop() pass is late
+  EXPECT_FALSE(fixture.driver_enable.state);
+
+  EXPECT_TRUE(fixture.run_until([&]() { return !fixture.bus.tx_active(); }, 100));
+  EXPECT_FALSE(fixture.bus.high_frequency());
+  EXPECT_TRUE(fixture.run_until([&]() { return zone1->has_response(); }, 200));
+}
+
+TEST(discovery_scan_takes_turns_with_the_polls)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1);
+  fixture.odu.add_zone(2);
+  // slower than the old 60ms probe timeout, but well inside a poll's
+  fixture.odu.add_zone(5).extra_latency_ms = 60;
+  auto *zone1 = fixture.add_zone(1);
+  fixture.bus.set_receive_wait_time(150);
+  fixture.bus.set_discovery_enabled(true);
+  fixture.bus.set_discovery_key("bus");
+  fixture.setup();
+
+  uint32_t start = millis();
+  EXPECT_TRUE(fixture.run_until([&]() { return fixture.bus.discovery_state() == DISCOVERY_CACHED; }, 120000));
+  ESP_LOGI("test", "scan took %" PRIu32 "ms", millis() - start);
+
+  EXPECT_EQ(3, fixture.bus.get_zone_map().count);
+  EXPECT_TRUE(fixture.bus.get_zone_map().find(5) != nullptr);
+  // a silent address is no bus fault, the known zone answered every poll
+  EXPECT_EQ(0u, fixture.bus.counters().timeouts);
+  EXPECT_EQ(0u, zone1->counters().timeouts);
+  // one poll per probe
+  uint32_t polls = zone1->counters().transactions;
+  EXPECT_GE(256, polls);
+  EXPECT_LE(256 + 16, polls);
+  EXPECT_TRUE(zone1->is_available());
+}
+
+TEST(boot_sweep_reaches_full_state_ahead_of_the_poll_wait)
+{
+  // five zones polled 500ms apart, one of them never answers
+  uint32_t elapsed[2];
+  for (int sweep = 0; sweep < 2; sweep++)
+  {
+    mock::reset_scheduler();
+    BusFixture fixture;
+    for (uint8_t zone = 1; zone <= 5; zone++)
+    {
+      fixture.odu.add_zone(zone).silent = zone == 5;
+      fixture.add_zone(zone);
+    }
+    fixture.bus.set_loop_wait_time(500);
+    fixture.bus.set_boot_sweep(sweep == 1);
+    uint32_t start = millis();
+    fixture.setup();
+
+    EXPECT_TRUE(fixture.run_until([&]() { return fixture.bus.full_state_reached(); }, 60000));
+    elapsed[sweep] = millis() - start;
+    ESP_LOGI("test", "boot sweep %s: full state after %" PRIu32 "ms", sweep == 1 ? "on" : "off", elapsed[sweep]);
+    EXPECT_FALSE(fixture.zones[4]->is_available());
+    for (int zone = 0; zone < 4; zone++)
+      EXPECT_TRUE(fixture.zones[zone]->has_response());
+  }
+  EXPECT_LE(elapsed[0] / 2, elapsed[1]);
+}
+
+TEST(boot_sweep_miss_counts_once_a_poll_confirms_it)
+{
+  BusFixture fixture;
+  // slower than the response timeout for its first request only
+  auto &slow = fixture.odu.add_zone(1);
+  slow.extra_latency_ms = 400;
+  fixture.odu.add_zone(2).silent = true;
+  auto *zone1 = fixture.add_zone(1);
+  auto *zone2 = fixture.add_zone(2);
+  fixture.bus.set_receive_wait_time(300);
+  fixture.setup();
+
+  EXPECT_TRUE(fixture.run_until([&]() { return zone1->counters().timeouts >= 1; }, 1000));
+  slow.extra_latency_ms = 0;
+  EXPECT_EQ(0, zone1->consecutive_failures());
+
+  // the late answer or the next poll clears it, the zone was never counted down
+  EXPECT_TRUE(fixture.run_until([&]() { return zone1->has_response(); }, 2000));
+  EXPECT_EQ(0, zone1->consecutive_failures());
+  EXPECT_TRUE(zone1->is_available());
+
+  // a zone that stays silent has its sweep miss confirmed and still goes unavailable within the sweep
+  EXPECT_TRUE(fixture.run_until([&]() { return fixture.bus.full_state_reached(); }, 5000));
+  EXPECT_FALSE(zone2->is_available());
+  EXPECT_EQ(3, zone2->consecutive_failures());
+  EXPECT_EQ(3u, zone2->counters().timeouts);
+}
@@ -0,0 +1,48 @@
+// the bus task on the host build, a real thread against the host clock. the task runs for as long as the firmware
+// does, so the fixture is never torn down and this file holds the one test that starts it
+#include <cinttypes>
+#include "bus_fixture.h"
+#include "lgap_test.h"
+
+using namespace lgap_test;
+
+TEST(bus_task_keeps_wire_times_through_a_stalled_loop)
+{
+  mock::set_realtime(true);
+  auto *fixture = new BusFixture();
+  fixture->odu.add_zone(1);
+  auto *zone1 = fixture->add_zone(1);
+  fixture->bus.set_bus_task(true);
+  fixture->bus.set_boot_sweep(false);
+  fixture->bus.set_trace_size(32);
+  fixture->setup();
+  fixture->bus.dump_config();
+
+  EXPECT_TRUE(fixture->run_until([&]() { return zone1->has_response(); }, 2000));
+
+  // the main loop stalls with a request on the wire, the task still sends it, drops the driver enable and keeps
+  // the answer along with the time it arrived
+  EXPECT_TRUE(fixture->run_until([&]() { return fixture->bus.in_flight_count() > 0; }, 2000));
+  uint32_t stall_start = millis();
+  delay(300);
+  EXPECT_FALSE(fixture->driver_enable.state);
+  EXPECT_TRUE(fixture->run_until([&]() { return zone1->counters().transactions >= 2; }, 2000));
+
+  const LGAPTrace &trace = fixture->bus.get_trace();
+  bool found = false;
+  for (uint16_t i = 0; i < trace.get_count(); i++)
+  {
+    const LGAPTraceRecord &record = trace.at(i);
+    if (record.direction != TRACE_RX || (int32_t)(record.time - stall_start) < 0)
+      continue;
+    // stamped when it came off the wire, not when the loop got round to it
+    EXPECT_LE(stall_start + 200, record.time);
+    found = true;
+    break;
+  }
+  EXPECT_TRUE(found);
+
+  // the stall isn't the zone's fault
+  EXPECT_EQ(0u, fixture->bus.counters().timeouts);
+  EXPECT_TRUE(zone1->is_available());
+}
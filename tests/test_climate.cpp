@@ -0,0 +1,335 @@
+// LGAPHVACClimate decoding, writes and their confirmation, locks and warm start
+#include <sstream>
+#include "bus_fixture.h"
+#include "lgap_test.h"
+
+using namespace lgap_test;
+
+namespace
+{
+  LGAPResponse parse_response(const std::string &text)
+  {
+    LGAPResponse response;
+    std::istringstream in(text);
+    int value;
+    for (size_t i = 0; i < LGAP_RESPONSE_LENGTH && in >> value; i++)
+      response.data[i] = value;
+    return response;
+  }
+} // namespace
+
+TEST(sample_responses_decode_into_the_climate)
+{
+  BusFixture fixture;
+  auto *zone = fixture.add_zone(0);
+  zone->set_temperature_publish_time(0);
+  fixture.setup();
+
+  // the four frames in ref/sample_responses.txt, see test_frame.cpp for the file itself
+  struct Expected
+  {
+    const char *response;
+    climate::ClimateMode mode;
+    climate::ClimateFanMode fan_mode;
+    float target_temperature;
+  };
+  const Expected samples[] = {
+      {"16 2 165 64 0 0 20 70 131 134 140 40 0 24 51 12", climate::CLIMATE_MODE_OFF, climate::CLIMATE_FAN_LOW, 21},
+      {"16 3 165 64 0 0 20 73 129 103 108 90 0 24 51 27", climate::CLIMATE_MODE_HEAT, climate::CLIMATE_FAN_LOW, 24},
+      {"16 3 165 64 0 0 48 65 129 113 103 40 0 24 51 96", climate::CLIMATE_MODE_COOL, climate::CLIMATE_FAN_HIGH, 16},
+      {"16 2 165 64 0 0 48 65 129 118 110 40 0 24 51 21", climate::CLIMATE_MODE_OFF, climate::CLIMATE_FAN_HIGH, 16},
+  };
+
+  for (const auto &sample : samples)
+  {
+    LGAPResponse frame = parse_response(sample.response);
+
+    zone->on_message_received(frame);
+    EXPECT_EQ(sample.mode, zone->mode);
+    EXPECT_EQ(sample.fan_mode, *zone->fan_mode);
+    EXPECT_EQ(sample.target_temperature, zone->target_temperature);
+    EXPECT_EQ((192 - frame.room_temperature_raw()) / 3, zone->current_temperature);
+  }
+}
+
+TEST(control_call_goes_out_as_one_confirmed_write)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1);
+  auto *zone = fixture.add_zone(1);
+  fixture.setup();
+  EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+
+  auto call = zone->make_call();
+  call.set_mode(climate::CLIMATE_MODE_HEAT);
+  call.set_fan_mode(climate::CLIMATE_FAN_MEDIUM);
+  call.set_target_temperature(23);
+  call.perform();
+  EXPECT_TRUE(zone->write_pending());
+
+  EXPECT_TRUE(fixture.run_until([&]() { return !zone->write_pending(); }, 2000));
+  EXPECT_EQ(1u, fixture.odu.writes);
+  const LGAPRequest *write = nullptr;
+  for (const auto &request : fixture.odu.seen)
+  {
+    if (request.is_write())
+      write = &request;
+  }
+  EXPECT_TRUE(write != nullptr);
+  if (write != nullptr)
+  {
+    // power and EXE, heat with fan medium, 23 - 15
+    EXPECT_EQ(0x03, write->control_flags());
+    EXPECT_EQ(0x24, write->mode_fan());
+    EXPECT_EQ(8, write->target_temperature_raw());
+  }
+  EXPECT_EQ(0x01, fixture.odu.zones[1].flags);
+  EXPECT_EQ(8, fixture.odu.zones[1].target_raw);
+  EXPECT_FALSE(zone->write_failed());
+
+  // nothing changes on the next polls
+  fixture.run_for(2000);
+  EXPECT_EQ(1u, fixture.odu.writes);
+  EXPECT_EQ(climate::CLIMATE_MODE_HEAT, zone->mode);
+  EXPECT_EQ(23.0f, zone->target_temperature);
+}
+
+TEST(write_confirmed_by_the_read_back)
+{
+  // the answer to the write still shows the old state, the read-back right after it shows the new one
+  BusFixture fixture;
+  fixture.odu.stale_write_answer = true;
+  // running, an off write is confirmed by any frame that shows the unit off
+  fixture.odu.add_zone(1).flags = 0x01;
+  auto *zone = fixture.add_zone(1);
+  fixture.setup();
+  EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+
+  auto call = zone->make_call();
+  call.set_target_temperature(25);
+  call.perform();
+  EXPECT_TRUE(fixture.run_until([&]() { return !zone->write_pending(); }, 2000));
+  EXPECT_EQ(1u, fixture.odu.writes);
+  EXPECT_EQ(25.0f, zone->target_temperature);
+  EXPECT_FALSE(zone->write_failed());
+}
+
+TEST(write_the_zone_ignores_fails_after_its_retries)
+{
+  BusFixture fixture;
+  auto &odu_zone = fixture.odu.add_zone(1);
+  odu_zone.flags = 0x01;
+  odu_zone.ignore_writes = true;
+  auto *zone = fixture.add_zone(1);
+  zone->set_write_retries(2);
+  uint32_t failed = 0;
+  zone->add_on_write_failed_callback([&failed]() { failed++; });
+  fixture.setup();
+  EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+
+  auto call = zone->make_call();
+  call.set_target_temperature(27);
+  call.perform();
+  EXPECT_TRUE(fixture.run_until([&]() { return failed > 0; }, 5000));
+  EXPECT_EQ(1u, failed);
+  EXPECT_EQ(3u, fixture.odu.writes);
+  EXPECT_TRUE(zone->write_failed());
+
+  // the unit's own set point wins
+  fixture.run_for(1000);
+  EXPECT_EQ(24.0f, zone->target_temperature);
+}
+
+TEST(write_to_a_zone_gone_quiet_fails_after_its_retries)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1).flags = 0x01;
+  auto *zone = fixture.add_zone(1);
+  zone->set_write_retries(2);
+  uint32_t failed = 0;
+  zone->add_on_write_failed_callback([&failed]() { failed++; });
+  fixture.bus.set_backoff_max(2000);
+  fixture.setup();
+  EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+
+  // the writes and their read-backs all time out
+  fixture.odu.zones[1].silent = true;
+  auto call = zone->make_call();
+  call.set_target_temperature(27);
+  call.perform();
+  EXPECT_TRUE(fixture.run_until([&]() { return failed > 0; }, 30000));
+  EXPECT_EQ(1u, failed);
+  EXPECT_EQ(3, zone->write_attempts());
+  EXPECT_EQ(1u, zone->write_failures());
+  EXPECT_TRUE(zone->write_failed());
+  EXPECT_FALSE(zone->write_pending());
+
+  // no more writes go out once it has given up
+  uint32_t writes = 0;
+  fixture.run_for(10000);
+  for (const auto &request : fixture.odu.seen)
+    writes += request.is_write() ? 1 : 0;
+  EXPECT_EQ(3u, writes);
+}
+
+TEST(temperature_lock_reverts_a_wall_change)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1).target_raw = 7;
+  auto *zone = fixture.add_zone(1);
+  LockTemperatureSwitch lock;
+  zone->set_lock_temperature_switch(&lock);
+  fixture.setup();
+  EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+
+  lock.turn_on();
+  EXPECT_TRUE(zone->lock_temperature());
+  EXPECT_TRUE(lock.state);
+
+  // someone at the wall controller
+  fixture.odu.zones[1].target_raw = 12;
+  EXPECT_TRUE(fixture.run_until([&]() { return fixture.odu.writes > 0 && !zone->write_pending(); }, 3000));
+  EXPECT_EQ(7, fixture.odu.zones[1].target_raw);
+  EXPECT_EQ(22.0f, zone->target_temperature);
+
+  // home assistant can't change it either
+  auto call = zone->make_call();
+  call.set_target_temperature(28);
+  call.perform();
+  EXPECT_EQ(22.0f, zone->target_temperature);
+}
+
+TEST(warm_start_publishes_the_last_state_before_the_first_answer)
+{
+  {
+    BusFixture fixture;
+    auto &odu_zone = fixture.odu.add_zone(1);
+    odu_zone.flags = 0x05;
+    odu_zone.mode_fan = 0x34;
+    odu_zone.target_raw = 10;
+    auto *zone = fixture.add_zone(1);
+    fixture.bus.set_state_save_delay(1000);
+    fixture.setup();
+    EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+    EXPECT_EQ(0u, global_preferences->saves_by_type[fixture.bus.state_key()]);
+    fixture.run_for(1500);
+    EXPECT_EQ(1u, global_preferences->saves_by_type[fixture.bus.state_key()]);
+  }
+
+  // the next boot, with the bus still quiet
+  mock::reset_scheduler();
+  BusFixture fixture;
+  fixture.odu.add_zone(1).silent = true;
+  auto *zone = fixture.add_zone(1);
+  ControlLockSwitch control_lock;
+  zone->set_control_lock_switch(&control_lock);
+  uint32_t saves = global_preferences->saves;
+  fixture.setup();
+
+  EXPECT_TRUE(zone->restored());
+  // with the zone in the bus record the climate's own preference is never made, so publishing writes nothing
+  EXPECT_EQ(saves, global_preferences->saves);
+  EXPECT_EQ(climate::CLIMATE_MODE_HEAT, zone->mode);
+  EXPECT_EQ(climate::CLIMATE_FAN_HIGH, *zone->fan_mode);
+  EXPECT_EQ(25.0f, zone->target_temperature);
+  EXPECT_TRUE(control_lock.state);
+  EXPECT_EQ(1u, zone->publishes);
+  EXPECT_FALSE(zone->has_response());
+}
+
+TEST(without_warm_start_the_climate_restores_its_own_state)
+{
+  {
+    BusFixture fixture;
+    auto &odu_zone = fixture.odu.add_zone(1);
+    odu_zone.flags = 0x05;
+    odu_zone.mode_fan = 0x34;
+    odu_zone.target_raw = 10;
+    auto *zone = fixture.add_zone(1);
+    fixture.bus.set_warm_start(false);
+    fixture.setup();
+    EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+  }
+
+  mock::reset_scheduler();
+  BusFixture fixture;
+  fixture.odu.add_zone(1).silent = true;
+  auto *zone = fixture.add_zone(1);
+  fixture.bus.set_warm_start(false);
+  fixture.setup();
+
+  // Climate::restore_state_() as before warm start, nothing restored from the bus record
+  EXPECT_FALSE(zone->restored());
+  EXPECT_EQ(climate::CLIMATE_MODE_HEAT, zone->mode);
+  EXPECT_EQ(25.0f, zone->target_temperature);
+}
+
+TEST(locks_set_before_the_first_answer_survive_a_restart)
+{
+  {
+    BusFixture fixture;
+    fixture.odu.add_zone(1).silent = true;
+    auto *zone = fixture.add_zone(1);
+    fixture.bus.set_state_save_delay(1000);
+    fixture.setup();
+    zone->set_lock_temperature(true);
+    fixture.run_for(1500);
+    EXPECT_FALSE(zone->has_response());
+    EXPECT_EQ(1u, global_preferences->saves_by_type[fixture.bus.state_key()]);
+  }
+
+  mock::reset_scheduler();
+  BusFixture fixture;
+  auto &odu_zone = fixture.odu.add_zone(1);
+  odu_zone.flags = 0x01;
+  odu_zone.target_raw = 10;
+  auto *zone = fixture.add_zone(1);
+  fixture.setup();
+
+  // only the lock is known, the rest isn't made up from the defaults of a zone that never answered
+  EXPECT_TRUE(zone->lock_temperature());
+  EXPECT_TRUE(zone->restored());
+  EXPECT_EQ(climate::CLIMATE_MODE_OFF, zone->mode);
+
+  // the first answer is taken as-is, then the lock holds its set point
+  EXPECT_TRUE(fixture.run_until([&]() { return zone->has_response(); }, 1000));
+  EXPECT_EQ(25.0f, zone->target_temperature);
+  EXPECT_TRUE(zone->lock_temperature());
+}
+
+TEST(bulk_command_counts_only_locked_zones_as_failed)
+{
+  BusFixture fixture;
+  fixture.odu.add_zone(1).flags = 0x01;
+  fixture.odu.add_zone(2);
+  fixture.odu.add_zone(3).flags = 0x01;
+  auto *running = fixture.add_zone(1);
+  auto *already_off = fixture.add_zone(2);
+  auto *locked = fixture.add_zone(3);
+  uint32_t completions = 0;
+  uint8_t confirmed = 0, failed = 0;
+  fixture.bus.add_on_bulk_complete_callback([&](uint8_t c, uint8_t f) {
+    completions++;
+    confirmed = c;
+    failed = f;
+  });
+  fixture.setup();
+  EXPECT_TRUE(fixture.run_until([&]() { return running->has_response() && already_off->has_response() && locked->has_response(); }, 2000));
+  locked->set_lock_mode(true);
+
+  LGAPBulkTarget all_off;
+  EXPECT_TRUE(parse_bulk_mode("off", all_off));
+  EXPECT_EQ(BULK_UNCHANGED, already_off->apply_bulk(all_off));
+
+  fixture.bus.bulk_command(all_off, -1, {});
+  EXPECT_TRUE(fixture.run_until([&]() { return completions > 0; }, 3000));
+  EXPECT_EQ(1u, completions);
+  EXPECT_EQ(2, confirmed);
+  EXPECT_EQ(1, failed);
+
+  // one write, for the zone that was running
+  EXPECT_EQ(1u, fixture.odu.writes);
+  EXPECT_EQ(0x00, fixture.odu.zones[1].flags);
+  EXPECT_EQ(0x01, fixture.odu.zones[3].flags);
+  EXPECT_EQ(climate::CLIMATE_MODE_OFF, running->mode);
+}
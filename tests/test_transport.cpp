@@ -0,0 +1,40 @@
+// the loopback transport, driven the way a bench test lambda would: on_write catches requests, feed() answers
+#include "bus_fixture.h"
+#include "lgap_test.h"
+
+using namespace lgap_test;
+
+TEST(loopback_carries_requests_and_answers)
+{
+  BusFixture fixture(FIXTURE_LOOPBACK);
+  fixture.bus.set_boot_sweep(false);
+  fixture.odu.add_zone(1).target_raw = 6;
+  fixture.odu.add_zone(2);
+  auto *zone1 = fixture.add_zone(1);
+  auto *zone2 = fixture.add_zone(2);
+  fixture.setup();
+
+  EXPECT_TRUE(fixture.run_until([&]() { return zone1->has_response() && zone2->has_response(); }, 2000));
+  EXPECT_EQ(6 + 15, zone1->target_temperature);
+  EXPECT_EQ(0u, fixture.bus.counters().timeouts);
+  EXPECT_EQ(0u, fixture.bus.counters().checksum_failures);
+  EXPECT_TRUE(zone1->is_available());
+  EXPECT_TRUE(zone2->is_available());
+}
+
+TEST(loopback_with_nothing_fed_times_out)
+{
+  BusFixture fixture(FIXTURE_LOOPBACK);
+  fixture.bus.set_boot_sweep(false);
+  fixture.odu.add_zone(1);
+  auto *zone1 = fixture.add_zone(1);
+  fixture.answer = false;
+  fixture.setup();
+
+  // requests still go out, they just go unanswered like on a bus with no ODU
+  EXPECT_TRUE(fixture.run_until([&]() { return fixture.bus.counters().timeouts >= 3; }, 10000));
+  EXPECT_GE(fixture.bus.counters().timeouts, fixture.odu.requests);
+  EXPECT_LE(fixture.bus.counters().timeouts + 1, fixture.odu.requests);
+  EXPECT_FALSE(zone1->has_response());
+  EXPECT_EQ(0, fixture.loopback.available());
+}
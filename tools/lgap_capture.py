@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""LGAP bus captures: extract, convert, show and replay.
+
+A capture file is the 8 byte magic "LGAPCAP1" followed by records, each packed
+little endian as time (uint32, ms), direction, outcome, length, then length
+bytes. This is the frame trace record of lgap_trace.h, so captures come
+straight off a device:
+
+    lgap.start_capture / lgap.stop_capture   stream every frame as it happens
+    lgap.dump_trace with format: capture     the trace buffer after an incident
+
+Both write one hex encoded record per log line under the lgap.capture tag,
+over serial or the API. "extract" turns a saved log into a capture file.
+
+replay plays a capture back as the ODU on a Linux pty, a serial port with
+--port, or a tcp port with --tcp, for the LGAP component to poll. Every request is answered with the
+next recorded answer for that zone, with the live request ID patched in so the
+responses match. Recorded timeouts stay unanswered and bad checksums stay bad.
+Responses keep their recorded latency, divided by --speed. Writes are not
+applied, the zones follow the recording.
+
+Examples:
+    # pull the capture lines out of a log saved from esphome logs
+    tools/lgap_capture.py extract lgap.log site-a.lgapcap
+
+    # the hand made captures in ref/
+    tools/lgap_capture.py convert ref/lgap-req-0.csv req-0.lgapcap
+
+    tools/lgap_capture.py show site-a.lgapcap
+
+    # replay at 4x on a pty linked to /tmp/lgap-odu, starting over when a zone runs out
+    tools/lgap_capture.py replay site-a.lgapcap --link /tmp/lgap-odu --speed 4 --loop
+"""
+
+import argparse
+import csv
+import os
+import re
+import select
+import struct
+import sys
+import time
+
+from lgap_odu_sim import REQUEST_LENGTH, checksum, open_port
+
+MAGIC = b"LGAPCAP1"
+RECORD_HEADER = struct.Struct("<IBBB")
+
+# TraceDirection and TraceOutcome in lgap_trace.h
+TX, RX, EVENT = 0, 1, 2
+DIRECTIONS = ("TX", "RX", "--")
+OK, TIMEOUT, CHECKSUM_FAILED, RESYNC, UNMATCHED, LATE = range(6)
+OUTCOMES = ("ok", "timeout", "bad checksum", "resync", "unmatched", "late")
+
+# esphome log lines look like [12:00:00][I][lgap.capture:109]: <hex>, colour codes and all
+CAPTURE_LINE = re.compile(r"\[lgap\.capture(?::\d+)?\]:?\s*([0-9a-fA-F]+)\s*$")
+ANSI = re.compile(r"\x1b\[[0-9;]*m")
+
+
+class Record:
+    def __init__(self, time_ms, direction, outcome, data):
+        self.time = time_ms
+        self.direction = direction
+        self.outcome = outcome
+        self.data = bytes(data)
+
+    def pack(self):
+        return RECORD_HEADER.pack(self.time, self.direction, self.outcome, len(self.data)) + self.data
+
+    def __str__(self):
+        if self.direction == EVENT:
+            return f"{self.time:10d} -- {OUTCOMES[self.outcome]}, zone {self.data[1]} request 0x{self.data[0]:02X}"
+        return f"{self.time:10d} {DIRECTIONS[self.direction]} {self.data.hex('.').upper()} ({OUTCOMES[self.outcome]})"
+
+
+def unpack(data, offset=0):
+    """Yield the records in data starting at offset."""
+    while offset + RECORD_HEADER.size <= len(data):
+        time_ms, direction, outcome, length = RECORD_HEADER.unpack_from(data, offset)
+        offset += RECORD_HEADER.size
+        if offset + length > len(data):
+            raise ValueError(f"truncated record at byte {offset - RECORD_HEADER.size}")
+        yield Record(time_ms, direction, outcome, data[offset:offset + length])
+        offset += length
+
+
+def read_capture(path):
+    with open(path, "rb") as file:
+        data = file.read()
+    if not data.startswith(MAGIC):
+        sys.exit(f"{path} is not an LGAP capture")
+    return list(unpack(data, len(MAGIC)))
+
+
+def write_capture(path, records):
+    with open(path, "wb") as file:
+        file.write(MAGIC)
+        for record in records:
+            file.write(record.pack())
+    print(f"wrote {len(records)} records to {path}", file=sys.stderr)
+
+
+def cmd_extract(args):
+    records = []
+    with open(args.log, errors="replace") as file:
+        for line in file:
+            match = CAPTURE_LINE.search(ANSI.sub("", line))
+            if match is None or len(match.group(1)) % 2:
+                continue
+            try:
+                records.extend(unpack(bytes.fromhex(match.group(1))))
+            except ValueError:
+                continue
+    # a trace dumped more than once, or dumped while streaming, repeats records
+    if not args.keep_duplicates:
+        seen = set()
+        unique = []
+        for record in records:
+            key = record.pack()
+            if key not in seen:
+                seen.add(key)
+                unique.append(record)
+        records = unique
+    write_capture(args.output, records)
+
+
+def cmd_convert(args):
+    """ref/lgap-req-*.csv: one request and its response per row, space separated decimal bytes, no timestamps."""
+    records = []
+    time_ms = 0
+    with open(args.csv, newline="") as file:
+        for row in csv.DictReader(file):
+            request = bytes(int(b) for b in row["request_bytes"].split())
+            response = bytes(int(b) for b in row["response_bytes"].split())
+            records.append(Record(time_ms, TX, OK, request))
+            if row["checksum_valid"] == "True":
+                records.append(Record(time_ms + args.latency, RX, OK, response))
+            else:
+                records.append(Record(time_ms + args.latency, EVENT, TIMEOUT, bytes((request[2], request[3]))))
+            time_ms += args.interval
+    write_capture(args.output, records)
+
+
+def cmd_show(args):
+    for record in read_capture(args.capture):
+        print(record)
+
+
+def build_answers(records):
+    """Per zone, the answer to each recorded request in order: (latency ms, frame, bad checksum), or None for no answer."""
+    answers = {}
+    pending = []  # (time, request id, zone) sent and not answered yet
+    for record in records:
+        if record.direction == TX and len(record.data) == REQUEST_LENGTH:
+            pending.append((record.time, record.data[2], record.data[3]))
+            continue
+        if record.direction == EVENT and record.outcome == TIMEOUT:
+            key = (record.data[0], record.data[1])
+        elif record.direction == RX and len(record.data) == 16 and record.outcome in (OK, LATE, CHECKSUM_FAILED, UNMATCHED):
+            key = (record.data[2], record.data[4])
+        else:
+            continue
+        for index, (sent, request_id, zone) in enumerate(pending):
+            if (request_id, zone) != key:
+                continue
+            del pending[index]
+            if record.direction == EVENT:
+                # a late answer may still follow, it replaces the timeout
+                answers.setdefault(zone, []).append([None, (sent, request_id)])
+            else:
+                answers.setdefault(zone, []).append([(record.time - sent, record.data, record.outcome == CHECKSUM_FAILED), None])
+            break
+        else:
+            if record.direction == RX:
+                # the answer to a request that already timed out
+                for answer in reversed(answers.get(key[1], [])):
+                    if answer[0] is None and answer[1][1] == key[0]:
+                        answer[0] = (record.time - answer[1][0], record.data, record.outcome == CHECKSUM_FAILED)
+                        break
+    # whatever never got an answer or a timeout, the capture ended first
+    return {zone: [answer[0] for answer in zone_answers] for zone, zone_answers in answers.items()}
+
+
+def cmd_replay(args):
+    answers = build_answers(read_capture(args.capture))
+    if not answers:
+        sys.exit(f"{args.capture} has no requests to replay")
+    read_fd, write, name = open_port(args)
+    print(f"LGAP replay of {args.capture} on {name}, zones {sorted(answers)} with "
+          + ", ".join(f"{zone}: {len(zone_answers)}" for zone, zone_answers in sorted(answers.items())) + " answers", file=sys.stderr)
+
+    byte_time = 10.0 / args.baud / args.speed if args.speed > 0 else 0.0
+    position = {zone: 0 for zone in answers}
+    stats = dict(requests=0, answered=0, unanswered=0, unknown_zone=0, exhausted=0, bad_checksum=0)
+    buffer = bytearray()
+    try:
+        while True:
+            readable, _, _ = select.select([read_fd], [], [], 0.5)
+            if not readable:
+                if args.loop or any(position[zone] < len(answers[zone]) for zone in answers):
+                    continue
+                break
+            try:
+                data = os.read(read_fd, 256)
+            except OSError:
+                # pty with nothing attached yet
+                time.sleep(0.1)
+                continue
+            if not data:
+                print("connection closed", file=sys.stderr)
+                break
+            buffer.extend(data)
+
+            while len(buffer) >= REQUEST_LENGTH:
+                request = buffer[:REQUEST_LENGTH]
+                if checksum(request) != request[7]:
+                    stats["bad_checksum"] += 1
+                    del buffer[0]
+                    continue
+                del buffer[:REQUEST_LENGTH]
+                stats["requests"] += 1
+
+                zone = request[3]
+                if zone not in answers:
+                    stats["unknown_zone"] += 1
+                    continue
+                if position[zone] >= len(answers[zone]):
+                    if not args.loop:
+                        stats["exhausted"] += 1
+                        continue
+                    position[zone] = 0
+                answer = answers[zone][position[zone]]
+                position[zone] += 1
+                if answer is None:
+                    stats["unanswered"] += 1
+                    continue
+
+                latency, frame, bad_checksum = answer
+                response = bytearray(frame)
+                response[2] = request[2]
+                response[15] = checksum(response) ^ (0xFF if bad_checksum else 0x00)
+                if args.speed > 0:
+                    time.sleep(max(0, latency) / 1000.0 / args.speed)
+                if byte_time > 0 and not args.port:
+                    for byte in response:
+                        write(bytes([byte]))
+                        time.sleep(byte_time)
+                else:
+                    write(bytes(response))
+                stats["answered"] += 1
+                if args.verbose:
+                    print(f"zone {zone}: {response.hex('.').upper()}", file=sys.stderr)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print(" ".join(f"{key}={value}" for key, value in stats.items()), file=sys.stderr)
+        if args.link and os.path.islink(args.link):
+            os.unlink(args.link)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    extract = commands.add_parser("extract", help="capture lines from an esphome log to a capture file")
+    extract.add_argument("log")
+    extract.add_argument("output")
+    extract.add_argument("--keep-duplicates", action="store_true", help="keep records seen more than once")
+    extract.set_defaults(func=cmd_extract)
+
+    convert = commands.add_parser("convert", help="a ref/lgap-req-*.csv capture to a capture file")
+    convert.add_argument("csv")
+    convert.add_argument("output")
+    convert.add_argument("--interval", type=int, default=500, help="ms between requests, the csv has no timestamps")
+    convert.add_argument("--latency", type=int, default=40, help="ms from request to response")
+    convert.set_defaults(func=cmd_convert)
+
+    show = commands.add_parser("show", help="print a capture file")
+    show.add_argument("capture")
+    show.set_defaults(func=cmd_show)
+
+    replay = commands.add_parser("replay", help="answer LGAP requests from a capture")
+    replay.add_argument("capture")
+    replay.add_argument("--port", help="serial port to use instead of a pty, requires pyserial")
+    replay.add_argument("--baud", type=int, default=4800)
+    replay.add_argument("--link", help="symlink to create pointing at the pty")
+    replay.add_argument("--tcp", type=int, metavar="PORT", help="listen on a tcp port like an RS485 bridge instead of using a pty")
+    replay.add_argument("--speed", type=float, default=1.0, help="1 is wire speed, 4 is four times faster, 0 answers with no delay")
+    replay.add_argument("--loop", action="store_true", help="start a zone over when its answers run out")
+    replay.add_argument("-v", "--verbose", action="store_true")
+    replay.set_defaults(func=cmd_replay)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
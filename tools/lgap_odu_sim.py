@@ -0,0 +1,355 @@
+#!/usr/bin/env python3
+"""Virtual LG outdoor unit (ODU) speaking LGAP.
+
+Attaches to a Linux pseudo-terminal (default) or a real serial port such as a
+USB-RS485 adapter, and answers 8 byte LGAP requests with 16 byte responses as
+described in protocol.md. Each zone runs a simple thermal model so room and
+pipe temperatures move over time, and faults can be injected to exercise the
+bus scheduler: response latency, dropped replies, corrupted checksums,
+mis-ordered request IDs and changes made at the wall controller.
+
+Examples:
+    # 8 zones on a pty, prints the device path to point the host build at
+    tools/lgap_odu_sim.py --zones 8 --link /tmp/lgap-odu
+
+    # ESP on a USB-RS485 adapter, 5% dropped replies and 40-80ms latency
+    tools/lgap_odu_sim.py --port /dev/ttyUSB0 --zones 0,1,2,5 --drop-rate 0.05 --latency 40 --jitter 40
+
+    # stand in for an RS485-to-TCP bridge, for an lgap bus with transport: tcp
+    tools/lgap_odu_sim.py --tcp 8899 --zones 4
+"""
+
+import argparse
+import os
+import random
+import select
+import socket
+import sys
+import time
+import tty
+
+REQUEST_LENGTH = 8
+RESPONSE_LENGTH = 16
+RESPONSE_HEADER = 0x10
+
+# mode codes (TX5/RX6 bits 0-2)
+MODE_COOL = 0
+MODE_DRY = 1
+MODE_FAN = 2
+MODE_AUTO = 3
+MODE_HEAT = 4
+
+DESIGN_LOADS = (9, 12, 24)
+
+
+def checksum(data):
+    """Sum of every byte but the last, modulo 256, XOR 0x55."""
+    return (sum(data[:-1]) & 0xFF) ^ 0x55
+
+
+def raw_from_celsius(celsius):
+    """Inverse of (192 - raw) / 3 used for RX8-RX10."""
+    return max(0, min(255, int(round(192 - celsius * 3))))
+
+
+class Zone:
+    def __init__(self, number, rng, ambient):
+        self.number = number
+        self.connected = True
+        self.power = False
+        self.mode = MODE_COOL
+        self.swing = 0
+        self.fan = 1
+        self.setpoint = 24
+        self.lock = False
+        self.plasma = False
+        self.error_code = 0
+        self.design_load = rng.choice(DESIGN_LOADS)
+        self.room = ambient + rng.uniform(-2.0, 2.0)
+        self.pipe_in = self.room
+        self.pipe_out = self.room
+
+    def apply_write(self, request):
+        """Apply the write fields of a request with TX4 bit1 (EXE) set."""
+        flags = request[4]
+        self.power = bool(flags & 0x01)
+        self.lock = bool(flags & 0x04)
+        self.plasma = bool(flags & 0x10)
+        self.mode = request[5] & 0x07
+        self.swing = (request[5] >> 3) & 0x01
+        fan = (request[5] >> 4) & 0x07
+        if fan != 0:  # 0 = no change
+            self.fan = fan
+        target = request[6] & 0x0F
+        if 1 <= target <= 15:
+            self.setpoint = target + 15
+
+    def running(self):
+        return self.power and self.connected
+
+    def demand(self):
+        """Signed demand in degrees, positive when the zone still has work to do."""
+        if not self.running():
+            return 0.0
+        if self.mode == MODE_HEAT:
+            return self.setpoint - self.room
+        if self.mode in (MODE_COOL, MODE_DRY):
+            return self.room - self.setpoint
+        if self.mode == MODE_AUTO:
+            return abs(self.room - self.setpoint)
+        return 0.0
+
+    def step(self, dt, ambient):
+        """Advance the thermal model by dt seconds."""
+        # leak towards ambient at all times
+        self.room += (ambient - self.room) * 0.002 * dt
+
+        if self.running():
+            rate = 0.01 * self.fan * dt
+            if self.mode == MODE_HEAT or (self.mode == MODE_AUTO and self.room < self.setpoint):
+                self.room += min(rate, max(0.0, self.setpoint - self.room))
+                pipe_target = 45.0
+            elif self.mode in (MODE_COOL, MODE_DRY) or self.mode == MODE_AUTO:
+                self.room -= min(rate, max(0.0, self.room - self.setpoint))
+                pipe_target = 8.0
+            else:
+                pipe_target = self.room
+        else:
+            pipe_target = self.room
+
+        # pipes lag their target, the outlet a little behind the inlet
+        self.pipe_in += (pipe_target - self.pipe_in) * min(1.0, 0.05 * dt)
+        self.pipe_out += (self.pipe_in - self.pipe_out) * min(1.0, 0.03 * dt)
+
+    def active_load(self):
+        """RX11, 204 at idle and lower as the zone works harder."""
+        if not self.running():
+            return 204
+        return max(80, 204 - int(max(0.0, self.demand()) * 20) - self.fan * 4)
+
+    def response(self, request_id, odu_total_load):
+        frame = bytearray(RESPONSE_LENGTH)
+        frame[0] = RESPONSE_HEADER
+        frame[1] = (0x01 if self.power else 0) | (0x02 if self.connected else 0) | (0x04 if self.lock else 0) | (0x10 if self.plasma else 0)
+        frame[2] = request_id
+        frame[3] = 0x40
+        frame[4] = self.number
+        frame[5] = self.error_code
+        frame[6] = (self.mode & 0x07) | (self.swing << 3) | ((self.fan & 0x07) << 4)
+        frame[7] = 0x40 | ((self.setpoint - 15) & 0x0F)
+        frame[8] = raw_from_celsius(self.room)
+        frame[9] = raw_from_celsius(self.pipe_in)
+        frame[10] = raw_from_celsius(self.pipe_out)
+        frame[11] = self.active_load()
+        frame[12] = 0 if self.running() else 1
+        frame[13] = self.design_load
+        frame[14] = odu_total_load
+        frame[15] = checksum(frame)
+        return frame
+
+
+class ODU:
+    def __init__(self, args, rng):
+        self.args = args
+        self.rng = rng
+        self.zones = {number: Zone(number, rng, args.ambient) for number in args.zones}
+        for number in args.disconnected:
+            if number in self.zones:
+                self.zones[number].connected = False
+        self.previous = None  # (request_id, zone) of the last answered request
+        self.odu_load = 0.0
+        self.stats = dict(requests=0, writes=0, responses=0, dropped=0, corrupted=0, misordered=0, unknown_zone=0,
+                          rejected_id=0, bad_checksum=0, wall_changes=0)
+
+    def step(self, dt):
+        for zone in self.zones.values():
+            zone.step(dt, self.args.ambient)
+        # RX14 is roughly the design load sum of running zones, smoothed
+        target = sum(zone.design_load for zone in self.zones.values() if zone.running())
+        self.odu_load += (target - self.odu_load) * min(1.0, 0.1 * dt)
+
+    def wall_change(self):
+        """Someone pressed buttons on a wall controller."""
+        zone = self.rng.choice(list(self.zones.values()))
+        change = self.rng.choice(("power", "setpoint", "fan", "mode"))
+        if change == "power":
+            zone.power = not zone.power
+        elif change == "setpoint":
+            zone.setpoint = max(16, min(30, zone.setpoint + self.rng.choice((-1, 1))))
+        elif change == "fan":
+            zone.fan = self.rng.choice((1, 2, 3))
+        else:
+            zone.mode = self.rng.choice((MODE_COOL, MODE_HEAT, MODE_FAN, MODE_DRY))
+        self.stats["wall_changes"] += 1
+        log(self.args, f"wall controller: zone {zone.number} {change} changed")
+
+    def handle(self, request):
+        """Return the response for a valid request, or None for no reply."""
+        self.stats["requests"] += 1
+        request_id = request[2]
+        number = request[3]
+
+        # the ODU only answers command IDs from 0xA0 upwards, see ref/lgap-req-2.csv
+        if request_id < self.args.min_request_id:
+            self.stats["rejected_id"] += 1
+            return None
+
+        zone = self.zones.get(number)
+        if zone is None:
+            self.stats["unknown_zone"] += 1
+            return None
+
+        if request[4] & 0x02:
+            self.stats["writes"] += 1
+            zone.apply_write(request)
+            log(self.args, f"write: zone {number} power={int(zone.power)} mode={zone.mode} fan={zone.fan} setpoint={zone.setpoint}")
+
+        if self.rng.random() < self.args.drop_rate:
+            self.stats["dropped"] += 1
+            return None
+
+        # answer the previous request instead of this one
+        if self.previous is not None and self.rng.random() < self.args.misorder_rate:
+            self.stats["misordered"] += 1
+            previous_id, previous_zone = self.previous
+            frame = self.zones[previous_zone].response(previous_id, int(round(self.odu_load)))
+        else:
+            frame = zone.response(request_id, int(round(self.odu_load)))
+        self.previous = (request_id, number)
+
+        if self.rng.random() < self.args.corrupt_rate:
+            self.stats["corrupted"] += 1
+            frame[15] ^= 0xFF
+
+        self.stats["responses"] += 1
+        return frame
+
+
+def log(args, message):
+    if args.verbose:
+        print(f"{time.monotonic():10.3f} {message}", file=sys.stderr)
+
+
+def open_port(args):
+    """Return (read_fd, write_fn, description)."""
+    if getattr(args, "tcp", None):
+        # one client at a time, like a transparent RS485 bridge
+        with socket.create_server(("", args.tcp)) as server:
+            print(f"waiting for a connection on tcp port {args.tcp}", file=sys.stderr)
+            connection, peer = server.accept()
+        connection.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return connection.fileno(), connection.sendall, f"tcp {peer[0]}:{peer[1]}"
+
+    if args.port:
+        try:
+            import serial  # pylint: disable=import-outside-toplevel
+        except ImportError:
+            sys.exit("pyserial is required for --port (pip install pyserial)")
+        port = serial.Serial(args.port, args.baud, bytesize=8, parity="N", stopbits=1, timeout=0)
+        return port.fileno(), port.write, args.port
+
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    name = os.ttyname(slave)
+    if args.link:
+        if os.path.islink(args.link):
+            os.unlink(args.link)
+        os.symlink(name, args.link)
+        name = f"{args.link} -> {name}"
+    return master, lambda data: os.write(master, data), name
+
+
+def parse_zones(value):
+    """'8' means zones 0-7, '0,1,5' is an explicit list."""
+    if "," not in value and value.isdigit():
+        return list(range(int(value)))
+    return [int(part, 0) for part in value.split(",") if part]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--zones", type=parse_zones, default=parse_zones("4"), help="zone count (1-64) or comma separated zone numbers")
+    parser.add_argument("--disconnected", type=parse_zones, default=[], help="zones that answer with the IDU connected bit cleared")
+    parser.add_argument("--port", help="serial port to use instead of a pty, requires pyserial")
+    parser.add_argument("--baud", type=int, default=4800)
+    parser.add_argument("--link", help="symlink to create pointing at the pty")
+    parser.add_argument("--tcp", type=int, metavar="PORT", help="listen on a tcp port like an RS485 bridge instead of using a pty")
+    parser.add_argument("--latency", type=float, default=30.0, help="response latency in ms")
+    parser.add_argument("--jitter", type=float, default=0.0, help="random extra latency in ms")
+    parser.add_argument("--wire-speed", action="store_true", help="pace responses at the configured baud rate on a pty")
+    parser.add_argument("--drop-rate", type=float, default=0.0, help="probability of not answering")
+    parser.add_argument("--corrupt-rate", type=float, default=0.0, help="probability of a bad checksum")
+    parser.add_argument("--misorder-rate", type=float, default=0.0, help="probability of answering the previous request instead")
+    parser.add_argument("--wall-change-interval", type=float, default=0.0, help="mean seconds between wall controller changes, 0 disables")
+    parser.add_argument("--min-request-id", type=int, default=0xA0, help="lowest TX2 command ID the ODU answers")
+    parser.add_argument("--ambient", type=float, default=24.0, help="ambient temperature in C")
+    parser.add_argument("--time-scale", type=float, default=1.0, help="speed up the thermal model")
+    parser.add_argument("--seed", type=int)
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    odu = ODU(args, rng)
+    read_fd, write, name = open_port(args)
+    print(f"LGAP ODU simulator on {name} with zones {sorted(odu.zones)}", file=sys.stderr)
+
+    byte_time = 10.0 / args.baud
+    buffer = bytearray()
+    last_step = time.monotonic()
+    next_wall_change = last_step + rng.expovariate(1.0 / args.wall_change_interval) if args.wall_change_interval > 0 else None
+
+    try:
+        while True:
+            readable, _, _ = select.select([read_fd], [], [], 0.05)
+            now = time.monotonic()
+            odu.step((now - last_step) * args.time_scale)
+            last_step = now
+
+            if next_wall_change is not None and now >= next_wall_change:
+                odu.wall_change()
+                next_wall_change = now + rng.expovariate(1.0 / args.wall_change_interval)
+
+            if not readable:
+                continue
+            try:
+                data = os.read(read_fd, 256)
+            except OSError:
+                # pty with nothing attached yet
+                time.sleep(0.1)
+                continue
+            if not data:
+                print("connection closed", file=sys.stderr)
+                break
+            buffer.extend(data)
+
+            # resync by sliding one byte at a time until a request checksums
+            while len(buffer) >= REQUEST_LENGTH:
+                request = buffer[:REQUEST_LENGTH]
+                if checksum(request) != request[7]:
+                    odu.stats["bad_checksum"] += 1
+                    del buffer[0]
+                    continue
+                del buffer[:REQUEST_LENGTH]
+
+                response = odu.handle(request)
+                if response is None:
+                    continue
+
+                time.sleep((args.latency + rng.uniform(0.0, args.jitter)) / 1000.0)
+                if args.wire_speed and not args.port:
+                    for byte in response:
+                        write(bytes([byte]))
+                        time.sleep(byte_time)
+                else:
+                    write(bytes(response))
+                log(args, "rx " + " ".join(f"{b:3d}" for b in request) + " | tx " + " ".join(f"{b:3d}" for b in response))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        print(" ".join(f"{key}={value}" for key, value in odu.stats.items()), file=sys.stderr)
+        if args.link and os.path.islink(args.link):
+            os.unlink(args.link)
+
+
+if __name__ == "__main__":
+    main()